@@ -0,0 +1,77 @@
+/*
+ * Throughput and accuracy of calcSunBatch against calcSun one event at a
+ * time, over 4096 random places with |lat| <= 65 for every day of 2016.
+ * The Makefile builds it at -O2, -O3 and -O3 -march=native, the last two
+ * letting the compiler vectorize the batch loop.
+ */
+#include <pebble.h>
+#include "utilities.h"
+#include "bench.h"
+
+#define SITES 4096
+#define DAYS 366
+#define EVENTS (SITES * DAYS)
+#define BATCH_ROUNDS 5
+
+static int s_days[EVENTS];
+static float s_latitudes[EVENTS], s_longitudes[EVENTS];
+static float s_rises[EVENTS], s_sets[EVENTS];
+
+int main(void)
+{
+  srand(1);
+  for (int i = 0; i < SITES; i++) {
+    float lat = rand() / (float)RAND_MAX * 130 - 65;
+    float lon = rand() / (float)RAND_MAX * 360 - 180;
+    for (int d = 0; d < DAYS; d++) {
+      s_days[i * DAYS + d] = d + 1;
+      s_latitudes[i * DAYS + d] = lat;
+      s_longitudes[i * DAYS + d] = lon;
+    }
+  }
+
+  double start = bench_now_ns();
+  for (int round = 0; round < BATCH_ROUNDS; round++)
+    calcSunBatch(EVENTS, s_days, s_latitudes, s_longitudes, ZENITH_OFFICIAL, s_rises, s_sets);
+  double batch_ns = bench_now_ns() - start;
+
+  float acc = 0;
+  start = bench_now_ns();
+  for (int i = 0; i < EVENTS; i++) {
+    int month, day;
+    bench_month_day(s_days[i], &month, &day);
+    acc += calcSun(2016, month, day, s_latitudes[i], s_longitudes[i], 0, ZENITH_OFFICIAL);
+    acc += calcSun(2016, month, day, s_latitudes[i], s_longitudes[i], 1, ZENITH_OFFICIAL);
+  }
+  double scalar_ns = bench_now_ns() - start;
+  bench_sink = acc;
+
+  double max = 0, sum = 0, max_scalar = 0;
+  int count = 0, polar = 0;
+  for (int i = 0; i < EVENTS; i++) {
+    int month, day;
+    bench_month_day(s_days[i], &month, &day);
+    for (int set = 0; set < 2; set++) {
+      double ref = ref_sun(2016, month, day, s_latitudes[i], s_longitudes[i], set, ZENITH_OFFICIAL);
+      float batch = set ? s_sets[i] : s_rises[i];
+      if (ref == 0 || batch == 0) {
+        polar += (ref == 0) != (batch == 0);
+        continue;
+      }
+      double e = bench_minutes_apart(batch * 60, ref * 60);
+      if (e > max) max = e;
+      sum += e;
+      count++;
+
+      float scalar = calcSun(2016, month, day, s_latitudes[i], s_longitudes[i], set, ZENITH_OFFICIAL);
+      if (scalar != 0 && bench_minutes_apart(batch * 60, scalar * 60) > max_scalar)
+        max_scalar = bench_minutes_apart(batch * 60, scalar * 60);
+    }
+  }
+
+  printf("calcSunBatch %.1f M events/s, calcSun %.1f M events/s\n",
+         2e3 * EVENTS * BATCH_ROUNDS / batch_ns, 2e3 * EVENTS / scalar_ns);
+  printf("against the double reference max %.2f min mean %.2f min, against calcSun max %.2f min, polar mismatches %d of %d events\n",
+         max, sum / count, max_scalar, polar, 2 * EVENTS);
+  return 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+/*
+ * Shared bits of the host benchmarks: a clock, a sink the optimizer cannot
+ * drop and the sunrise/sunset algorithm of utilities.c in double precision,
+ * which is the reference the watch solvers are measured against.
+ */
+#include <math.h>
+#include <time.h>
+
+static volatile double bench_sink;
+
+static inline double bench_now_ns(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/* Month and day of month from a day of the year (1 based) in a leap year */
+static inline void bench_month_day(int yday, int *month, int *day)
+{
+  static const int lengths[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  int m = 0;
+  while (yday > lengths[m]) yday -= lengths[m++];
+  *month = m + 1;
+  *day = yday;
+}
+
+/* Difference of two times of day in minutes, across midnight if shorter */
+static inline double bench_minutes_apart(double a, double b)
+{
+  double d = fabs(a - b);
+  return d > 720 ? 1440 - d : d;
+}
+
+/**
+ * calcSun in double precision
+ *
+ * @return Hours UTC, 0 when the sun does not cross the zenith that day
+ */
+static inline double ref_sun(int year, int month, int day, double latitude, double longitude, int sunset, double zenith)
+{
+  const double rad = M_PI / 180;
+  int N1 = 275 * month / 9, N2 = (month + 9) / 12, N3 = 1 + (year - 4 * (year / 4) + 2) / 3;
+  int N = N1 - N2 * N3 + day - 30;
+
+  double lngHour = longitude / 15;
+  double t = N + ((sunset ? 18 : 6) - lngHour) / 24;
+  double M = 0.9856 * t - 3.289;
+  double L = fmod(M + 1.916 * sin(rad * M) + 0.020 * sin(2 * rad * M) + 282.634 + 720, 360);
+  double RA = fmod(atan2(0.91764 * sin(rad * L), cos(rad * L)) / rad + 360, 360) / 15;
+
+  double sinDec = 0.39782 * sin(rad * L), cosDec = cos(asin(sinDec));
+  double cosH = (cos(rad * zenith) - sinDec * sin(rad * latitude)) / (cosDec * cos(rad * latitude));
+  if (cosH > 1 || cosH < -1) return 0;
+
+  double H = (sunset ? acos(cosH) / rad : 360 - acos(cosH) / rad) / 15;
+  double T = H + RA - 0.06571 * t - 6.622;
+  return fmod(T - lngHour + 48, 24);
+}
@@ -0,0 +1,97 @@
+/*
+ * The table driven formatting in utilities.c against strftime and snprintf:
+ * every date and day of a year must match strftime, and the tick path
+ * strings are timed both ways.
+ */
+#include <pebble.h>
+#include "utilities.h"
+#include "bench.h"
+
+#define ROUNDS 1000000
+
+static void run_checks()
+{
+  static const int numbers[] = { 0, 5, 9, 10, 99, 100, 999, 1000, 1001, 12345, 100000, 1234567, -5, -1234 };
+  char a[32], b[32];
+  int mismatches = 0;
+
+  printf("format_number:");
+  for (unsigned i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+    format_number(a, sizeof(a), numbers[i]);
+    printf(" %s", a);
+  }
+  printf("\n");
+
+  // Two years from 1970 at 13:07, every day compared against strftime
+  for (int d = 0; d < 731; d++) {
+    time_t t = d * SECONDS_PER_DAY + 13 * SECONDS_PER_HOUR + 7 * SECONDS_PER_MINUTE;
+    struct tm *tm = gmtime(&t);
+    format_date(a, 12, tm);
+    strftime(b, 12, "%d %b", tm);
+    mismatches += strcmp(a, b) != 0;
+    format_day(a, 8, tm);
+    strftime(b, 8, "%a", tm);
+    mismatches += strcmp(a, b) != 0;
+    format_two_digits(a, tm->tm_min);
+    strftime(b, 4, "%M", tm);
+    mismatches += strcmp(a, b) != 0;
+  }
+  printf("date, day and minute mismatches against strftime: %d\n", mismatches);
+}
+
+static void run_timings()
+{
+  char a[32], b[32];
+  time_t t = 1000 * SECONDS_PER_DAY;
+  struct tm *tm = gmtime(&t);
+  int acc = 0;
+
+  double start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    strftime(a, 4, "%H", tm);
+    strftime(b, 4, "%M", tm);
+    strftime(a, 12, "%d %b", tm);
+    strftime(b, 8, "%a", tm);
+    acc += a[0] + b[0];
+  }
+  double strftime_ns = (bench_now_ns() - start) / ROUNDS;
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    format_two_digits(a, tm->tm_hour);
+    format_two_digits(b, tm->tm_min);
+    format_date(a, 12, tm);
+    format_day(b, 8, tm);
+    acc += a[0] + b[0];
+  }
+  double format_ns = (bench_now_ns() - start) / ROUNDS;
+  printf("tick time and date strings: strftime %.0f ns, format_* %.0f ns\n", strftime_ns, format_ns);
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    snprintf(a, 10, "%d,%03d", (i + 1000) / 1000, (i + 1000) % 1000);
+    snprintf(b, 10, "%d%%", i % 100);
+    acc += a[0] + b[0];
+  }
+  double snprintf_ns = (bench_now_ns() - start) / ROUNDS;
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    format_number(a, 10, i + 1000);
+    char *p = format_append_number(b, b + 10, i % 100);
+    format_append(p, b + 10, "%");
+    acc += a[0] + b[0];
+  }
+  double number_ns = (bench_now_ns() - start) / ROUNDS;
+  printf("steps and percentage: snprintf %.0f ns, format_* %.0f ns\n", snprintf_ns, number_ns);
+
+  bench_sink = acc;
+}
+
+int main(void)
+{
+  format_init();
+  run_checks();
+  run_timings();
+  return 0;
+}
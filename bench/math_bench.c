@@ -0,0 +1,211 @@
+/*
+ * Accuracy and cost of the float kernels in utilities.c against libm, the
+ * baseline for any change to the sun math. Errors are absolute unless the
+ * row says rel, over evenly spaced inputs across the whole range. strtod is
+ * also fuzzed with malformed strings, and the bench fails if it disagrees
+ * with libc or a call takes too long.
+ */
+#include <pebble.h>
+#include "utilities.h"
+#include "bench.h"
+
+#define ERROR_SAMPLES 2000000
+#define TIMING_INPUTS 4096
+#define TIMING_ROUNDS 1000
+
+typedef float (*Kernel)(float);
+
+static double ref_tan(double x) { return tan(x); }
+static double ref_sqrt(double x) { return sqrt(x); }
+
+static void run_kernel(const char *name, Kernel kernel, double (*ref)(double), double lo, double hi, bool relative)
+{
+  double max = 0, sum = 0, worst = lo;
+  for (int i = 0; i < ERROR_SAMPLES; i++) {
+    double x = lo + (hi - lo) * i / (ERROR_SAMPLES - 1);
+    double r = ref((float)x);
+    double e = fabs(kernel((float)x) - r);
+    if (relative && fabs(r) > 1e-3) e /= fabs(r);
+    if (e > max) {
+      max = e;
+      worst = x;
+    }
+    sum += e;
+  }
+
+  static float inputs[TIMING_INPUTS];
+  for (int i = 0; i < TIMING_INPUTS; i++) inputs[i] = lo + (hi - lo) * i / (TIMING_INPUTS - 1);
+  float acc = 0;
+  double start = bench_now_ns();
+  for (int k = 0; k < TIMING_ROUNDS; k++)
+    for (int i = 0; i < TIMING_INPUTS; i++) acc += kernel(inputs[i]);
+  double ns = (bench_now_ns() - start) / ((double)TIMING_ROUNDS * TIMING_INPUTS);
+  bench_sink = acc;
+
+  char range[32];
+  snprintf(range, sizeof(range), "[%g, %g]", lo, hi);
+  printf("%-9s %-15s %-4s max %.2e  mean %.2e  %6.1f ns  (worst at %g)\n", name, range,
+         relative ? "rel" : "abs", max, sum / ERROR_SAMPLES, ns, worst);
+}
+
+/* Coordinates as the phone used to send them, 6 decimals */
+static void run_strtod()
+{
+  enum { COUNT = 200000 };
+  static char text[COUNT][16];
+  double max = 0;
+
+  srand(1);
+  for (int i = 0; i < COUNT; i++) snprintf(text[i], sizeof(text[i]), "%.6f", rand() / (double)RAND_MAX * 360 - 180);
+  for (int i = 0; i < COUNT; i++) {
+    double expected;
+    sscanf(text[i], "%lf", &expected);
+    double e = fabs(strtod(text[i], NULL) - expected);
+    if (e > max) max = e;
+  }
+
+  double acc = 0, start = bench_now_ns();
+  for (int k = 0; k < 10; k++)
+    for (int i = 0; i < COUNT; i++) acc += strtod(text[i], NULL);
+  double ns = (bench_now_ns() - start) / (10.0 * COUNT);
+  bench_sink = acc;
+
+  printf("%-9s %-15s %-4s max %.2e  %-14s  %6.1f ns\n", "strtod", "coordinates", "abs", max, "", ns);
+}
+
+#define FUZZ_STRINGS 1000000
+#define FUZZ_MAX_LENGTH 24
+#define FUZZ_TOLERANCE 1e-12
+// The longest strings take a few us, this only catches loops that run away
+#define FUZZ_MAX_CALL_NS 50000
+// Calls slower than this are timed again, the host may just have been busy
+#define FUZZ_RETIME_NS 10000
+
+/*
+ * libc's value of a coordinate string. utilities.c's strtod replaces libc's
+ * in this link, so it is read with sscanf, up to the first x since libc
+ * would take "0x" as hex and the watch's parser reads decimal only.
+ */
+static double fuzz_expected(const char *text)
+{
+  char decimal[FUZZ_MAX_LENGTH + 1];
+  size_t length = strcspn(text, "xX");
+  memcpy(decimal, text, length);
+  decimal[length] = 0;
+  double value;
+  return sscanf(decimal, "%lf", &value) == 1 ? value : 0;
+}
+
+static bool fuzz_equal(double a, double b)
+{
+  if (isinf(a) || isinf(b)) return a == b;
+  return fabs(a - b) <= FUZZ_TOLERANCE * fmax(fabs(a), fabs(b)) + 1e-300;
+}
+
+static double fuzz_call_ns(const char *text, double *value)
+{
+  double start = bench_now_ns();
+  *value = strtod(text, NULL);
+  return bench_now_ns() - start;
+}
+
+/* One string, false with a message when it is wrong or slow */
+static bool fuzz_one(const char *text, double expected, double *worst_ns)
+{
+  double value;
+  double ns = fuzz_call_ns(text, &value);
+  for (int retry = 0; retry < 5 && ns > FUZZ_RETIME_NS; retry++) ns = fmin(ns, fuzz_call_ns(text, &value));
+  if (ns > *worst_ns) *worst_ns = ns;
+
+  if (!fuzz_equal(value, expected)) {
+    printf("strtod(\"%.40s\") = %.17g, libc %.17g\n", text, value, expected);
+    return false;
+  }
+  if (ns > FUZZ_MAX_CALL_NS) {
+    printf("strtod(\"%.40s\") took %.0f ns\n", text, ns);
+    return false;
+  }
+  return true;
+}
+
+/* Random strings of the characters a broken message could hold, then a few long ones */
+static bool run_strtod_fuzz()
+{
+  static const char alphabet[] = "0123456789.-+eE x";
+  char text[FUZZ_MAX_LENGTH + 1];
+  double worst_ns = 0;
+  int failures = 0;
+
+  srand(2);
+  for (int i = 0; i < FUZZ_STRINGS && failures < 10; i++) {
+    int length = rand() % (FUZZ_MAX_LENGTH + 1);
+    for (int k = 0; k < length; k++) text[k] = alphabet[rand() % (sizeof(alphabet) - 1)];
+    text[length] = 0;
+    failures += !fuzz_one(text, fuzz_expected(text), &worst_ns);
+  }
+
+  // Huge exponents and long mantissas, what the exponent cap is for
+  static const struct { const char *prefix; double expected; } edges[] = {
+    { "1e", INFINITY }, { "0e", 0 }, { "1e-", 0 }, { "0.", 1 }, { "1e+", INFINITY }
+  };
+  static char edge[1100];
+  for (size_t e = 0; e < sizeof(edges) / sizeof(edges[0]); e++) {
+    snprintf(edge, sizeof(edge), "%s", edges[e].prefix);
+    memset(edge + strlen(edge), '9', 1000);
+    edge[strlen(edges[e].prefix) + 1000] = 0;
+    failures += !fuzz_one(edge, edges[e].expected, &worst_ns);
+  }
+
+  printf("%-9s %-15s %-4s %d failures  worst call %.0f ns\n", "strtod", "fuzz", "", failures, worst_ns);
+  return failures == 0;
+}
+
+/* Official zenith, every day of 2016 on a 5 degree grid */
+static void run_calc_sun()
+{
+  double max = 0, sum = 0;
+  int count = 0, polar = 0;
+
+  for (int lat = -65; lat <= 65; lat += 5)
+    for (int lon = -180; lon <= 180; lon += 30)
+      for (int yday = 1; yday <= 366; yday++) {
+        int month, day;
+        bench_month_day(yday, &month, &day);
+        for (int set = 0; set < 2; set++) {
+          double r = ref_sun(2016, month, day, lat, lon, set, ZENITH_OFFICIAL);
+          float v = calcSun(2016, month, day, lat, lon, set, ZENITH_OFFICIAL);
+          if (r == 0 || v == 0) {
+            polar += (r == 0) != (v == 0);
+            continue;
+          }
+          double e = bench_minutes_apart(v * 60, r * 60);
+          if (e > max) max = e;
+          sum += e;
+          count++;
+        }
+      }
+
+  enum { CALLS = 200000 };
+  float acc = 0;
+  double start = bench_now_ns();
+  for (int i = 0; i < CALLS; i++) acc += calcSun(2016, i % 12 + 1, i % 28 + 1, i % 120 - 60, i % 360 - 180, i & 1, ZENITH_OFFICIAL);
+  double ns = (bench_now_ns() - start) / CALLS;
+  bench_sink = acc;
+
+  printf("%-9s %-15s %-4s max %.3f min mean %.3f min %6.1f ns  (polar mismatches %d)\n", "calcSun", "|lat| <= 65", "abs", max, sum / count, ns, polar);
+}
+
+int main(void)
+{
+  run_kernel("my_sqrt", my_sqrt, ref_sqrt, 1e-3, 1e4, true);
+  run_kernel("my_sin", my_sin, sin, -50, 50, false);
+  run_kernel("my_cos", my_cos, cos, -50, 50, false);
+  run_kernel("my_tan", my_tan, ref_tan, -1.5, 1.5, true);
+  run_kernel("my_atan", my_atan, atan, -100, 100, false);
+  run_kernel("my_asin", my_asin, asin, -1, 1, false);
+  run_kernel("my_acos", my_acos, acos, -1, 1, false);
+  run_strtod();
+  bool fuzz_passed = run_strtod_fuzz();
+  run_calc_sun();
+  return fuzz_passed ? 0 : 1;
+}
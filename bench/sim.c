@@ -0,0 +1,278 @@
+/*
+ * Runs the watchface against the stub SDK on a simulated clock, a day in
+ * a few milliseconds, and counts the work it does in each simulated hour:
+ * frames and update procs, layer_mark_dirty calls, health queries, messages
+ * and storage writes.
+ *
+ * The wearer sleeps 23:00-07:00 and walks to work and back, the phone
+ * sends its battery as the JS does, the watch battery drains and charges,
+ * bluetooth drops for 20 minutes each afternoon and the wrist is tapped
+ * twice a day. Times are local, set TZ to move them (London by default).
+ *
+ * Usage: sim [-d days] [-s yyyy-mm-dd] [-l lat,lon] [-v]
+ */
+#include <getopt.h>
+#include "stub.h"
+#include "bench.h"
+
+// The watch's main is built as nixi_main, see the Makefile
+#undef main
+int nixi_main(void);
+
+#if defined(PBL_PLATFORM_APLITE)
+#define PLATFORM "aplite"
+#define HEAP_BYTES (24 * 1024)
+#elif defined(PBL_PLATFORM_DIORITE)
+#define PLATFORM "diorite"
+#define HEAP_BYTES (64 * 1024)
+#else
+#define PLATFORM "basalt"
+#define HEAP_BYTES (64 * 1024)
+#endif
+
+#define HOURS_PER_DAY 24
+#define MS_PER_MINUTE (SECONDS_PER_MINUTE * 1000LL)
+#define MS_PER_HOUR (SECONDS_PER_HOUR * 1000LL)
+
+static const char *s_count_names[STUB_COUNT_COUNT] = {
+  "frames", "draws", "gfx", "dirty", "health", "sent", "recv", "writes", "bytes", "timers"
+};
+
+static double s_lat = 51.5074, s_lon = -0.1278;
+static int s_days = 1;
+static const char *s_start_date = "2017-06-21";
+static time_t s_start;
+static int64_t s_end_ms;
+static size_t s_end_heap;
+
+/* The world */
+
+static int local_minute(time_t t, int *wday)
+{
+  struct tm *tm = localtime(&t);
+  if (wday) *wday = tm->tm_wday;
+  return tm->tm_hour * MINUTES_PER_HOUR + tm->tm_min;
+}
+
+static bool asleep(time_t t)
+{
+  int m = local_minute(t, NULL);
+  return m < 7 * MINUTES_PER_HOUR || m >= 23 * MINUTES_PER_HOUR;
+}
+
+static int steps(time_t minute)
+{
+  int wday;
+  int m = local_minute(minute, &wday);
+  if (m < 7 * MINUTES_PER_HOUR || m >= 23 * MINUTES_PER_HOUR) return 0;
+
+  bool workday = wday > 0 && wday < 6;
+  if (workday && ((m >= 8 * 60 && m < 8 * 60 + 40) || (m >= 17 * 60 + 30 && m < 18 * 60 + 10))) return 110;
+  if (m >= 12 * 60 + 15 && m < 12 * 60 + 45) return 90;
+  // Pottering about the rest of the day, a few steps every few minutes
+  return (minute / SECONDS_PER_MINUTE) % 5 == 0 ? 12 : 0;
+}
+
+/* The phone, as src/pkjs/index.js behaves */
+
+#define PHONE_SEND_DELAY_MS 1000
+#define PHONE_SEND_INTERVAL_MS 2000
+
+static DictionaryIterator s_phone_pending;
+static bool s_phone_sending;
+static int s_phone_battery = 80;
+static bool s_phone_charging = false;
+
+static void phone_flush(void *data)
+{
+  s_phone_sending = false;
+  if (!s_phone_pending.count) return;
+  DictionaryIterator message = s_phone_pending;
+  s_phone_pending.count = 0;
+  stub_inbox(&message);
+}
+
+// Merge into the pending message, sent at most every PHONE_SEND_INTERVAL_MS
+static void phone_queue(uint32_t key, int32_t value)
+{
+  Tuple *tuple = dict_find(&s_phone_pending, key);
+  if (tuple) {
+    tuple->value->int32 = value;
+  } else {
+    dict_write_int(&s_phone_pending, key, &value, sizeof(value), true);
+  }
+  if (s_phone_sending) return;
+  s_phone_sending = true;
+  stub_schedule(stub_now_ms() + PHONE_SEND_INTERVAL_MS, phone_flush, NULL);
+}
+
+static void phone_ready(void *data)
+{
+  // The stored fix is forwarded at start, with the battery the listeners report
+  phone_queue(MESSAGE_KEY_PhoneBatteryCharging, s_phone_charging);
+  phone_queue(MESSAGE_KEY_PhoneBattery, s_phone_battery);
+  phone_queue(MESSAGE_KEY_LongitudeE6, (int32_t)round(s_lon * 1000000));
+  phone_queue(MESSAGE_KEY_LatitudeE6, (int32_t)round(s_lat * 1000000));
+}
+
+static void phone_received(const DictionaryIterator *iterator)
+{
+  // A request for the location, the fix is fresh and has not moved, so
+  // nothing is sent back
+}
+
+/* Scripted events, checked once a minute half way through it */
+
+static int s_watch_battery = 100;
+static bool s_watch_charging = false;
+
+static void world_minute(void *data)
+{
+  time_t now = stub_time(NULL);
+  int m = local_minute(now, NULL);
+  int elapsed = (now - s_start) / SECONDS_PER_MINUTE;
+
+  // The watch loses 1% every 100 minutes and charges to full from 10%
+  if (s_watch_charging ? elapsed % 2 == 0 : elapsed % 100 == 99) {
+    s_watch_battery += s_watch_charging ? 1 : -1;
+    if (s_watch_battery <= 10) s_watch_charging = true;
+    if (s_watch_battery >= 100) s_watch_charging = false;
+    stub_set_battery((BatteryChargeState) { s_watch_battery, s_watch_charging, s_watch_charging });
+  }
+
+  // The phone charges overnight and loses 1% every 15 minutes in the day
+  bool charging = m >= 23 * MINUTES_PER_HOUR || m < 6 * MINUTES_PER_HOUR;
+  if (charging != s_phone_charging) {
+    s_phone_charging = charging;
+    phone_queue(MESSAGE_KEY_PhoneBatteryCharging, charging);
+  }
+  int level = charging ? s_phone_battery + (s_phone_battery < 100 && elapsed % 3 == 0) : s_phone_battery - (elapsed % 15 == 0 && s_phone_battery > 5);
+  if (level != s_phone_battery) {
+    s_phone_battery = level;
+    phone_queue(MESSAGE_KEY_PhoneBattery, level);
+  }
+
+  if (m == 14 * MINUTES_PER_HOUR) stub_set_connected(false);
+  if (m == 14 * MINUTES_PER_HOUR + 20) stub_set_connected(true);
+  if (m == 9 * MINUTES_PER_HOUR || m == 20 * MINUTES_PER_HOUR + 15) stub_tap();
+
+  if (stub_now_ms() + MS_PER_MINUTE < s_end_ms) stub_schedule(stub_now_ms() + MS_PER_MINUTE, world_minute, NULL);
+}
+
+/* Counting */
+
+static uint32_t s_hour_counts[HOURS_PER_DAY][STUB_COUNT_COUNT];
+static uint32_t s_last_counts[STUB_COUNT_COUNT];
+static uint32_t s_max_day[STUB_COUNT_COUNT];
+static uint32_t s_day_start[STUB_COUNT_COUNT];
+
+// At the end of each hour, the counts go to the local hour that has passed
+static void world_hour(void *data)
+{
+  time_t now = stub_time(NULL);
+  time_t before = now - SECONDS_PER_HOUR;
+  int hour = localtime(&before)->tm_hour;
+
+  for (int i = 0; i < STUB_COUNT_COUNT; i++) {
+    s_hour_counts[hour][i] += stub_counts[i] - s_last_counts[i];
+    s_last_counts[i] = stub_counts[i];
+  }
+
+  if ((now - s_start) % SECONDS_PER_DAY == 0) {
+    for (int i = 0; i < STUB_COUNT_COUNT; i++) {
+      uint32_t day = stub_counts[i] - s_day_start[i];
+      if (day > s_max_day[i]) s_max_day[i] = day;
+      s_day_start[i] = stub_counts[i];
+    }
+  }
+
+  if (stub_now_ms() < s_end_ms) stub_schedule(stub_now_ms() + MS_PER_HOUR, world_hour, NULL);
+}
+
+static void print_row(const char *label, const uint32_t *counts, int days)
+{
+  printf("%-6s", label);
+  for (int i = 0; i < STUB_COUNT_COUNT; i++) {
+    if (days > 1) {
+      printf(" %8.1f", (double)counts[i] / days);
+    } else {
+      printf(" %8u", counts[i]);
+    }
+  }
+  printf("\n");
+}
+
+static void report(double wall_ms)
+{
+  printf("%s, %d day%s from %s at %.4f,%.4f, %s per hour of the day\n", PLATFORM, s_days, s_days > 1 ? "s" : "",
+         s_start_date, s_lat, s_lon, s_days > 1 ? "mean" : "count");
+  printf("%-6s", "hour");
+  for (int i = 0; i < STUB_COUNT_COUNT; i++) printf(" %8s", s_count_names[i]);
+  printf("\n");
+
+  for (int h = 0; h < HOURS_PER_DAY; h++) {
+    char label[8];
+    snprintf(label, sizeof(label), "%02d", h);
+    print_row(label, s_hour_counts[h], s_days);
+  }
+  print_row("day", stub_counts, s_days);
+  if (s_days > 1) print_row("max", s_max_day, 1);
+
+  printf("heap peak %d B of %d, %d B at the end, %d B at exit\n", (int)stub_heap_peak(), HEAP_BYTES, (int)s_end_heap, (int)heap_bytes_used());
+  printf("simulated %d day%s in %.0f ms\n", s_days, s_days > 1 ? "s" : "", wall_ms);
+}
+
+/* The run */
+
+// The app's event loop, the whole simulation runs inside it
+void app_event_loop(void)
+{
+  stub_schedule(stub_now_ms() + PHONE_SEND_DELAY_MS, phone_ready, NULL);
+  stub_schedule(stub_now_ms() + 30 * 1000, world_minute, NULL);
+  stub_schedule(stub_now_ms() + MS_PER_HOUR, world_hour, NULL);
+  stub_run_until(s_end_ms);
+  s_end_heap = heap_bytes_used();
+}
+
+static const StubWorld s_world = {
+  .steps = steps,
+  .asleep = asleep,
+  .outbox = phone_received
+};
+
+int main(int argc, char **argv)
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "d:s:l:v")) != -1) {
+    switch (opt) {
+      case 'd': s_days = atoi(optarg); break;
+      case 's': s_start_date = optarg; break;
+      case 'l': sscanf(optarg, "%lf,%lf", &s_lat, &s_lon); break;
+      case 'v': stub_log_level = APP_LOG_LEVEL_DEBUG; break;
+      default:
+        fprintf(stderr, "usage: %s [-d days] [-s yyyy-mm-dd] [-l lat,lon] [-v]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (s_days < 1) s_days = 1;
+
+  setenv("TZ", getenv("TZ") ? getenv("TZ") : "GMT0BST,M3.5.0/1,M10.5.0", 1);
+  tzset();
+
+  struct tm day = { .tm_isdst = -1 };
+  if (sscanf(s_start_date, "%d-%d-%d", &day.tm_year, &day.tm_mon, &day.tm_mday) != 3) {
+    fprintf(stderr, "bad start date %s\n", s_start_date);
+    return 1;
+  }
+  day.tm_year -= 1900;
+  day.tm_mon -= 1;
+  s_start = mktime(&day);
+
+  stub_start(s_start, HEAP_BYTES, &s_world);
+  s_end_ms = stub_now_ms() + s_days * HOURS_PER_DAY * MS_PER_HOUR;
+
+  double wall = bench_now_ns();
+  nixi_main();
+  report((bench_now_ns() - wall) / 1e6);
+  return 0;
+}
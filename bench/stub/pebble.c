@@ -0,0 +1,1001 @@
+/*
+ * Host implementations of the stubbed SDK calls. The trig lookups are
+ * exact (rounded libm), so they are the reference the integer trig is
+ * measured against rather than a copy of the firmware tables.
+ *
+ * The services are fakes on a simulated clock: time() reads it, timers and
+ * ticks fire as stub_run_until moves it on, and the health service answers
+ * from the StubWorld the driver passes to stub_start. Layers, bitmaps and
+ * the frame buffer are real enough for the code that reads pixels back,
+ * text is drawn as a filled box and radial fills are only counted.
+ */
+#include <math.h>
+#include <stddef.h>
+#include "stub.h"
+
+// The watch code allocates through stub_malloc, the stub itself does not
+#undef malloc
+#undef free
+
+uint32_t stub_counts[STUB_COUNT_COUNT];
+AppLogLevel stub_log_level = APP_LOG_LEVEL_ERROR;
+
+int32_t sin_lookup(int32_t angle)
+{
+  return (int32_t)lround(sin(angle * 2 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+int32_t cos_lookup(int32_t angle)
+{
+  return (int32_t)lround(cos(angle * 2 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+int32_t atan2_lookup(int16_t y, int16_t x)
+{
+  double a = atan2(y, x);
+  if (a < 0) a += 2 * M_PI;
+  return (int32_t)lround(a * TRIG_MAX_ANGLE / (2 * M_PI)) & 0xffff;
+}
+
+/* Heap */
+
+// Sizes are kept in front of each block, aligned for any type
+typedef union {
+  size_t size;
+  max_align_t align;
+} HeapHeader;
+
+static size_t s_heap_limit = 64 * 1024;
+static size_t s_heap_used;
+static size_t s_heap_peak;
+
+void *stub_malloc(size_t size)
+{
+  if (s_heap_used + size > s_heap_limit) return NULL;
+  HeapHeader *header = malloc(sizeof(HeapHeader) + size);
+  if (!header) return NULL;
+  header->size = size;
+  s_heap_used += size;
+  if (s_heap_used > s_heap_peak) s_heap_peak = s_heap_used;
+  return header + 1;
+}
+
+void stub_free(void *ptr)
+{
+  if (!ptr) return;
+  HeapHeader *header = (HeapHeader *)ptr - 1;
+  s_heap_used -= header->size;
+  free(header);
+}
+
+static void *stub_calloc(size_t size)
+{
+  void *ptr = stub_malloc(size);
+  if (ptr) memset(ptr, 0, size);
+  return ptr;
+}
+
+size_t heap_bytes_used(void)
+{
+  return s_heap_used;
+}
+
+size_t heap_bytes_free(void)
+{
+  return s_heap_limit - s_heap_used;
+}
+
+size_t stub_heap_peak(void)
+{
+  return s_heap_peak;
+}
+
+/* Storage */
+
+#define PERSIST_ENTRIES 64
+
+typedef struct {
+  uint32_t key;
+  int length;   // -1 when the slot is free
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} PersistEntry;
+
+static PersistEntry s_persist[PERSIST_ENTRIES];
+
+static PersistEntry *persist_find(uint32_t key)
+{
+  for (int i = 0; i < PERSIST_ENTRIES; i++) {
+    if (s_persist[i].length >= 0 && s_persist[i].key == key) return &s_persist[i];
+  }
+  return NULL;
+}
+
+int persist_read_data(uint32_t key, void *buffer, size_t buffer_size)
+{
+  PersistEntry *entry = persist_find(key);
+  if (!entry) return E_DOES_NOT_EXIST;
+  int length = entry->length < (int)buffer_size ? entry->length : (int)buffer_size;
+  memcpy(buffer, entry->data, length);
+  return length;
+}
+
+int persist_write_data(uint32_t key, const void *data, size_t size)
+{
+  if (size > PERSIST_DATA_MAX_LENGTH) size = PERSIST_DATA_MAX_LENGTH;
+  PersistEntry *entry = persist_find(key);
+  for (int i = 0; !entry && i < PERSIST_ENTRIES; i++) {
+    if (s_persist[i].length < 0) entry = &s_persist[i];
+  }
+  if (!entry) return -1;
+
+  entry->key = key;
+  entry->length = size;
+  memcpy(entry->data, data, size);
+  stub_counts[STUB_PERSIST_WRITE]++;
+  stub_counts[STUB_PERSIST_BYTES] += size;
+  return size;
+}
+
+bool persist_exists(uint32_t key)
+{
+  return persist_find(key) != NULL;
+}
+
+status_t persist_delete(uint32_t key)
+{
+  PersistEntry *entry = persist_find(key);
+  if (!entry) return E_DOES_NOT_EXIST;
+  entry->length = -1;
+  stub_counts[STUB_PERSIST_WRITE]++;
+  return 0;
+}
+
+/* Bitmaps */
+
+struct GBitmap {
+  GBitmapFormat format;
+  GRect bounds;
+  GSize size;
+  uint16_t stride;
+  uint8_t *data;
+  GColor *palette;
+  bool free_palette;
+};
+
+static uint16_t bitmap_stride(GSize size, GBitmapFormat format)
+{
+  switch (format) {
+    case GBitmapFormat1Bit: return (size.w + 31) / 32 * 4;
+    case GBitmapFormat8Bit: return size.w;
+    case GBitmapFormat1BitPalette: return (size.w + 7) / 8;
+    case GBitmapFormat2BitPalette: return (size.w + 3) / 4;
+    default: return (size.w + 1) / 2;
+  }
+}
+
+GBitmap *gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor *palette, bool free_on_destroy)
+{
+  GBitmap *bitmap = stub_calloc(sizeof(GBitmap));
+  if (!bitmap) return NULL;
+  bitmap->format = format;
+  bitmap->size = size;
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  bitmap->stride = bitmap_stride(size, format);
+  bitmap->data = stub_calloc(bitmap->stride * size.h);
+  if (!bitmap->data) {
+    stub_free(bitmap);
+    return NULL;
+  }
+  bitmap->palette = palette;
+  bitmap->free_palette = free_on_destroy;
+  return bitmap;
+}
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format)
+{
+  return gbitmap_create_blank_with_palette(size, format, NULL, false);
+}
+
+void gbitmap_destroy(GBitmap *bitmap)
+{
+  if (!bitmap) return;
+  if (bitmap->free_palette) stub_free(bitmap->palette);
+  stub_free(bitmap->data);
+  stub_free(bitmap);
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap)
+{
+  return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap)
+{
+  return bitmap->stride;
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap)
+{
+  return bitmap->bounds;
+}
+
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds)
+{
+  bitmap->bounds = bounds;
+}
+
+GColor *gbitmap_get_palette(const GBitmap *bitmap)
+{
+  return bitmap->palette;
+}
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y)
+{
+  return (GBitmapDataRowInfo) { bitmap->data + y * bitmap->stride, 0, bitmap->size.w - 1 };
+}
+
+/* Fonts */
+
+struct StubFont {
+  int height;
+};
+
+struct StubResource {
+  uint32_t id;
+};
+
+// Only the size of the text matters here, a handle is all a custom font costs
+static struct StubFont s_system_fonts[] = { { 18 }, { 24 }, { 42 } };
+static struct StubResource s_resources[] = { { RESOURCE_ID_PIXELS_49 } };
+
+ResHandle resource_get_handle(uint32_t resource_id)
+{
+  return &s_resources[0];
+}
+
+GFont fonts_get_system_font(const char *font_key)
+{
+  if (strstr(font_key, "18")) return &s_system_fonts[0];
+  if (strstr(font_key, "24")) return &s_system_fonts[1];
+  return &s_system_fonts[2];
+}
+
+GFont fonts_load_custom_font(ResHandle handle)
+{
+  GFont font = stub_malloc(sizeof(struct StubFont));
+  if (font) font->height = 49;
+  return font;
+}
+
+void fonts_unload_custom_font(GFont font)
+{
+  stub_free(font);
+}
+
+/* Graphics */
+
+struct GContext {
+  GBitmap *fb;
+  GPoint offset;     // Of the layer being drawn
+  GColor fill;
+  GColor text;
+  bool captured;
+};
+
+static GBitmap *s_fb;
+static GContext s_ctx;
+
+static void set_pixel(GBitmap *fb, int x, int y, GColor color)
+{
+  if (x < 0 || y < 0 || x >= fb->size.w || y >= fb->size.h) return;
+  uint8_t *row = fb->data + y * fb->stride;
+  if (fb->format == GBitmapFormat8Bit) {
+    row[x] = color.argb;
+  } else if (color.argb == GColorWhite.argb) {
+    row[x >> 3] |= 1 << (x & 7);
+  } else {
+    row[x >> 3] &= ~(1 << (x & 7));
+  }
+}
+
+static void fill_box(GContext *ctx, GRect rect, GColor color)
+{
+  if (color.argb == GColorClear.argb) return;
+  int x0 = ctx->offset.x + rect.origin.x;
+  int y0 = ctx->offset.y + rect.origin.y;
+  for (int y = y0; y < y0 + rect.size.h; y++) {
+    for (int x = x0; x < x0 + rect.size.w; x++) set_pixel(ctx->fb, x, y, color);
+  }
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color)
+{
+  ctx->fill = color;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color)
+{
+}
+
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width)
+{
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color)
+{
+  ctx->text = color;
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode)
+{
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask)
+{
+  stub_counts[STUB_GRAPHICS]++;
+  fill_box(ctx, rect, ctx->fill);
+}
+
+void graphics_fill_radial(GContext *ctx, GRect rect, GOvalScaleMode scale_mode, uint16_t inset, int32_t angle_start, int32_t angle_end)
+{
+  stub_counts[STUB_GRAPHICS]++;
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1)
+{
+  stub_counts[STUB_GRAPHICS]++;
+}
+
+GSize graphics_text_layout_get_content_size(const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode, GTextAlignment alignment)
+{
+  // Glyphs half as wide as the font is tall
+  int w = (int)strlen(text) * font->height / 2;
+  return GSize(w < box.size.w ? w : box.size.w, font->height < box.size.h ? font->height : box.size.h);
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode, GTextAlignment alignment, void *text_attributes)
+{
+  stub_counts[STUB_GRAPHICS]++;
+  GSize size = graphics_text_layout_get_content_size(text, font, box, overflow_mode, alignment);
+  int x = box.origin.x;
+  if (alignment == GTextAlignmentCenter) x += (box.size.w - size.w) / 2;
+  if (alignment == GTextAlignmentRight) x += box.size.w - size.w;
+  // A box inset by the stroke of the glyphs stands in for them
+  fill_box(ctx, GRect(x + 2, box.origin.y + 2, size.w - 4, size.h - 4), ctx->text);
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect)
+{
+  stub_counts[STUB_GRAPHICS]++;
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx)
+{
+  if (ctx->captured) return NULL;
+  ctx->captured = true;
+  return ctx->fb;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer)
+{
+  ctx->captured = false;
+  return true;
+}
+
+/* Windows and layers */
+
+// Children are a sibling list as in the firmware, so a layer costs about as much heap
+struct Layer {
+  GRect frame;
+  LayerUpdateProc update_proc;
+  bool hidden;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+};
+
+struct Window {
+  Layer *root;
+  WindowHandlers handlers;
+  bool loaded;
+};
+
+static Window *s_top_window;
+static bool s_dirty;
+
+Layer *layer_create(GRect frame)
+{
+  Layer *layer = stub_calloc(sizeof(Layer));
+  if (layer) layer->frame = frame;
+  return layer;
+}
+
+void layer_destroy(Layer *layer)
+{
+  if (!layer) return;
+  if (layer->parent) {
+    Layer **link = &layer->parent->first_child;
+    while (*link != layer) link = &(*link)->next_sibling;
+    *link = layer->next_sibling;
+  }
+  for (Layer *child = layer->first_child; child; child = child->next_sibling) child->parent = NULL;
+  stub_free(layer);
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc)
+{
+  layer->update_proc = update_proc;
+}
+
+void layer_add_child(Layer *parent, Layer *child)
+{
+  Layer **link = &parent->first_child;
+  while (*link) link = &(*link)->next_sibling;
+  *link = child;
+  child->parent = parent;
+}
+
+void layer_mark_dirty(Layer *layer)
+{
+  stub_counts[STUB_MARK_DIRTY]++;
+  s_dirty = true;
+}
+
+GRect layer_get_bounds(const Layer *layer)
+{
+  return GRect(0, 0, layer->frame.size.w, layer->frame.size.h);
+}
+
+GRect layer_get_frame(const Layer *layer)
+{
+  return layer->frame;
+}
+
+void layer_set_hidden(Layer *layer, bool hidden)
+{
+  if (layer->hidden == hidden) return;
+  layer->hidden = hidden;
+  layer_mark_dirty(layer);
+}
+
+// A layer drawing its text in its update proc, each setter marks it dirty as the firmware's do
+struct TextLayer {
+  Layer layer;
+  const char *text;
+  GFont font;
+  GColor text_color;
+  GColor background_color;
+  GTextAlignment alignment;
+};
+
+static void text_layer_update(Layer *layer, GContext *ctx)
+{
+  TextLayer *text_layer = (TextLayer *)layer;
+  GRect bounds = layer_get_bounds(layer);
+  if (text_layer->background_color.argb != GColorClear.argb) fill_box(ctx, bounds, text_layer->background_color);
+  if (!text_layer->text || !text_layer->text[0]) return;
+  graphics_context_set_text_color(ctx, text_layer->text_color);
+  graphics_draw_text(ctx, text_layer->text, text_layer->font, bounds, GTextOverflowModeWordWrap, text_layer->alignment, NULL);
+}
+
+TextLayer *text_layer_create(GRect frame)
+{
+  TextLayer *text_layer = stub_calloc(sizeof(TextLayer));
+  if (!text_layer) return NULL;
+  text_layer->layer.frame = frame;
+  text_layer->layer.update_proc = text_layer_update;
+  text_layer->font = fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD);
+  text_layer->text_color = GColorBlack;
+  text_layer->background_color = GColorWhite;
+  text_layer->alignment = GTextAlignmentLeft;
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer)
+{
+  // The layer is the first member, layer_destroy frees the whole text layer
+  if (text_layer) layer_destroy(&text_layer->layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer)
+{
+  return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text)
+{
+  text_layer->text = text;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font)
+{
+  text_layer->font = font;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color)
+{
+  text_layer->text_color = color;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color)
+{
+  text_layer->background_color = color;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment)
+{
+  text_layer->alignment = text_alignment;
+  layer_mark_dirty(&text_layer->layer);
+}
+
+Window *window_create(void)
+{
+  Window *window = stub_calloc(sizeof(Window));
+  if (!window) return NULL;
+  window->root = layer_create(GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT));
+  return window;
+}
+
+void window_destroy(Window *window)
+{
+  if (window->loaded && window->handlers.unload) window->handlers.unload(window);
+  if (s_top_window == window) s_top_window = NULL;
+  layer_destroy(window->root);
+  stub_free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers)
+{
+  window->handlers = handlers;
+}
+
+void window_stack_push(Window *window, bool animated)
+{
+  s_top_window = window;
+  if (!window->loaded && window->handlers.load) window->handlers.load(window);
+  window->loaded = true;
+  if (window->handlers.appear) window->handlers.appear(window);
+  s_dirty = true;
+}
+
+Layer *window_get_root_layer(const Window *window)
+{
+  return window->root;
+}
+
+static void render_layer(Layer *layer, GPoint origin)
+{
+  if (layer->hidden) return;
+  origin.x += layer->frame.origin.x;
+  origin.y += layer->frame.origin.y;
+  if (layer->update_proc) {
+    s_ctx.offset = origin;
+    stub_counts[STUB_DRAW]++;
+    layer->update_proc(layer, &s_ctx);
+  }
+  for (Layer *child = layer->first_child; child; child = child->next_sibling) render_layer(child, origin);
+}
+
+// The firmware redraws the whole window whenever a layer of it is dirty
+static void render()
+{
+  if (!s_dirty || !s_top_window) return;
+  s_dirty = false;
+  stub_counts[STUB_FRAME]++;
+  memset(s_fb->data, s_fb->format == GBitmapFormat8Bit ? GColorWhite.argb : 0xff, s_fb->stride * s_fb->size.h);
+  render_layer(s_top_window->root, GPoint(0, 0));
+}
+
+/* Clock and event loop */
+
+struct AppTimer {
+  int64_t at_ms;
+  AppTimerCallback callback;
+  void *data;
+  bool counted;
+  AppTimer *next;
+};
+
+static const StubWorld *s_world;
+static int64_t s_now_ms;
+static int64_t s_next_minute_ms;
+static AppTimer *s_timers;
+static TimeUnits s_tick_units;
+static TickHandler s_tick_handler;
+
+time_t stub_time(time_t *tloc)
+{
+  time_t now = (time_t)(s_now_ms / 1000);
+  if (tloc) *tloc = now;
+  return now;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms)
+{
+  uint16_t ms = (uint16_t)(s_now_ms % 1000);
+  if (tloc) *tloc = (time_t)(s_now_ms / 1000);
+  if (out_ms) *out_ms = ms;
+  return ms;
+}
+
+int64_t stub_now_ms(void)
+{
+  return s_now_ms;
+}
+
+time_t time_start_of_today(void)
+{
+  time_t now = stub_time(NULL);
+  struct tm day = *localtime(&now);
+  day.tm_hour = day.tm_min = day.tm_sec = 0;
+  day.tm_isdst = -1;
+  return mktime(&day);
+}
+
+bool clock_is_24h_style(void)
+{
+  return true;
+}
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler)
+{
+  s_tick_units = tick_units;
+  s_tick_handler = handler;
+}
+
+void tick_timer_service_unsubscribe(void)
+{
+  s_tick_handler = NULL;
+}
+
+static AppTimer *add_timer(int64_t at_ms, AppTimerCallback callback, void *data, bool counted)
+{
+  AppTimer *timer = malloc(sizeof(AppTimer));
+  *timer = (AppTimer) { at_ms, callback, data, counted, NULL };
+  // After the timers due at the same time, so they fire in order
+  AppTimer **link = &s_timers;
+  while (*link && (*link)->at_ms <= at_ms) link = &(*link)->next;
+  timer->next = *link;
+  *link = timer;
+  return timer;
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data)
+{
+  return add_timer(s_now_ms + timeout_ms, callback, callback_data, true);
+}
+
+void app_timer_cancel(AppTimer *timer)
+{
+  for (AppTimer **link = &s_timers; *link; link = &(*link)->next) {
+    if (*link != timer) continue;
+    *link = timer->next;
+    free(timer);
+    return;
+  }
+}
+
+void stub_schedule(int64_t at_ms, AppTimerCallback callback, void *data)
+{
+  add_timer(at_ms, callback, data, false);
+}
+
+/* Health */
+
+static HealthEventHandler s_health_handler;
+static void *s_health_context;
+static int64_t s_health_subscribed_ms = -1;
+
+// Steps of each minute of today, built when the day changes
+static time_t s_steps_day = -1;
+static int32_t s_steps_before[MINUTES_PER_HOUR * 24 + 1];
+
+static void check_steps_day(time_t start)
+{
+  if (s_steps_day == start) return;
+  s_steps_day = start;
+  s_steps_before[0] = 0;
+  for (int m = 0; m < MINUTES_PER_HOUR * 24; m++) {
+    s_steps_before[m + 1] = s_steps_before[m] + s_world->steps(start + m * SECONDS_PER_MINUTE);
+  }
+}
+
+HealthValue health_service_sum_today(HealthMetric metric)
+{
+  stub_counts[STUB_HEALTH_QUERY]++;
+  if (metric != HealthMetricStepCount) return 0;
+  time_t start = time_start_of_today();
+  check_steps_day(start);
+  int minutes = (stub_time(NULL) - start) / SECONDS_PER_MINUTE;
+  return s_steps_before[minutes < MINUTES_PER_HOUR * 24 ? minutes : MINUTES_PER_HOUR * 24];
+}
+
+HealthValue health_service_sum_averaged(HealthMetric metric, time_t time_start, time_t time_end, HealthServiceTimeScope scope)
+{
+  stub_counts[STUB_HEALTH_QUERY]++;
+  if (metric != HealthMetricStepCount) return 0;
+  // The average day is a tenth less active than the days the wearer has
+  HealthValue steps = 0;
+  for (time_t t = time_start; t < time_end; t += SECONDS_PER_MINUTE) steps += s_world->steps(t);
+  return steps * 9 / 10;
+}
+
+HealthActivityMask health_service_peek_current_activities(void)
+{
+  stub_counts[STUB_HEALTH_QUERY]++;
+  return s_world->asleep(stub_time(NULL)) ? HealthActivitySleep : HealthActivityNone;
+}
+
+uint32_t health_service_get_minute_history(HealthMinuteData *minute_data, uint32_t max_records, time_t *time_start, time_t *time_end)
+{
+  stub_counts[STUB_HEALTH_QUERY]++;
+  time_t now = stub_time(NULL);
+  time_t start = *time_start - *time_start % SECONDS_PER_MINUTE;
+  time_t end = *time_end < now ? *time_end : now;
+  uint32_t count = 0;
+  for (time_t t = start; t + SECONDS_PER_MINUTE <= end && count < max_records; t += SECONDS_PER_MINUTE) {
+    int steps = s_world->steps(t);
+    minute_data[count++] = (HealthMinuteData) { .steps = steps > 255 ? 255 : steps };
+  }
+  *time_start = start;
+  *time_end = start + count * SECONDS_PER_MINUTE;
+  return count;
+}
+
+bool health_service_events_subscribe(HealthEventHandler handler, void *context)
+{
+  s_health_handler = handler;
+  s_health_context = context;
+  // The firmware follows a subscription with a significant update
+  s_health_subscribed_ms = s_now_ms;
+  return true;
+}
+
+bool health_service_events_unsubscribe(void)
+{
+  s_health_handler = NULL;
+  return true;
+}
+
+/* Battery, connection and taps */
+
+static BatteryChargeState s_battery = { 100, false, false };
+static BatteryStateHandler s_battery_handler;
+static bool s_connected = true;
+static ConnectionHandler s_connection_handler;
+static AccelTapHandler s_tap_handler;
+
+BatteryChargeState battery_state_service_peek(void)
+{
+  return s_battery;
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler)
+{
+  s_battery_handler = handler;
+}
+
+bool connection_service_peek_pebble_app_connection(void)
+{
+  return s_connected;
+}
+
+void connection_service_subscribe(ConnectionHandlers handlers)
+{
+  s_connection_handler = handlers.pebble_app_connection_handler;
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler)
+{
+  s_tap_handler = handler;
+}
+
+void vibes_double_pulse(void)
+{
+}
+
+void stub_set_battery(BatteryChargeState state)
+{
+  s_battery = state;
+  if (s_battery_handler) s_battery_handler(state);
+  render();
+}
+
+void stub_set_connected(bool connected)
+{
+  if (connected == s_connected) return;
+  s_connected = connected;
+  if (s_connection_handler) s_connection_handler(connected);
+  render();
+}
+
+void stub_tap(void)
+{
+  if (s_tap_handler) s_tap_handler(ACCEL_AXIS_Z, 1);
+  render();
+}
+
+/* AppMessage */
+
+const uint32_t MESSAGE_KEY_Longitude = 10000;
+const uint32_t MESSAGE_KEY_Latitude = 10001;
+const uint32_t MESSAGE_KEY_PhoneBattery = 10002;
+const uint32_t MESSAGE_KEY_PhoneBatteryCharging = 10003;
+const uint32_t MESSAGE_KEY_LongitudeE6 = 10004;
+const uint32_t MESSAGE_KEY_LatitudeE6 = 10005;
+
+static AppMessageInboxReceived s_inbox_handler;
+static DictionaryIterator s_outbox;
+static bool s_outbox_open;
+
+AppMessageResult app_message_open(uint32_t size_inbound, uint32_t size_outbound)
+{
+  return APP_MSG_OK;
+}
+
+void app_message_register_inbox_received(AppMessageInboxReceived received_callback)
+{
+  s_inbox_handler = received_callback;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator)
+{
+  if (s_outbox_open) {
+    *iterator = NULL;
+    return APP_MSG_BUSY;
+  }
+  s_outbox_open = true;
+  s_outbox.count = 0;
+  *iterator = &s_outbox;
+  return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_send(void)
+{
+  if (!s_outbox_open) return APP_MSG_SEND_REJECTED;
+  s_outbox_open = false;
+  stub_counts[STUB_MESSAGE_SEND]++;
+  if (s_connected && s_world->outbox) s_world->outbox(&s_outbox);
+  return APP_MSG_OK;
+}
+
+static Tuple *dict_add(DictionaryIterator *iter, uint32_t key, TupleType type)
+{
+  if (iter->count == (int)(sizeof(iter->tuples) / sizeof(iter->tuples[0]))) return NULL;
+  Tuple *tuple = &iter->tuples[iter->count++];
+  memset(tuple, 0, sizeof(Tuple));
+  tuple->key = key;
+  tuple->type = type;
+  return tuple;
+}
+
+int dict_write_int(DictionaryIterator *iter, uint32_t key, const void *integer, uint8_t width_bytes, bool is_signed)
+{
+  Tuple *tuple = dict_add(iter, key, is_signed ? TUPLE_INT : TUPLE_UINT);
+  if (!tuple) return -1;
+  tuple->length = width_bytes;
+  memcpy(&tuple->value->int32, integer, width_bytes < 4 ? width_bytes : 4);
+  return 0;
+}
+
+int dict_write_cstring(DictionaryIterator *iter, uint32_t key, const char *value)
+{
+  Tuple *tuple = dict_add(iter, key, TUPLE_CSTRING);
+  if (!tuple) return -1;
+  snprintf(tuple->value->cstring, sizeof(tuple->value->cstring), "%s", value);
+  tuple->length = strlen(tuple->value->cstring) + 1;
+  return 0;
+}
+
+uint32_t dict_write_end(DictionaryIterator *iter)
+{
+  return iter->count;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, uint32_t key)
+{
+  for (int i = 0; i < iter->count; i++) {
+    if (iter->tuples[i].key == key) return (Tuple *)&iter->tuples[i];
+  }
+  return NULL;
+}
+
+void stub_inbox(const DictionaryIterator *iterator)
+{
+  if (!s_inbox_handler) return;
+  stub_counts[STUB_MESSAGE_RECEIVE]++;
+  s_inbox_handler((DictionaryIterator *)iterator, NULL);
+  render();
+}
+
+/* Driver */
+
+void stub_start(time_t start, size_t heap_bytes, const StubWorld *world)
+{
+  s_now_ms = (int64_t)start * 1000;
+  s_next_minute_ms = (s_now_ms / 60000 + 1) * 60000;
+  s_heap_limit = heap_bytes;
+  s_world = world;
+  for (int i = 0; i < PERSIST_ENTRIES; i++) s_persist[i].length = -1;
+
+#if defined(PBL_COLOR)
+  s_fb = gbitmap_create_blank(GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT), GBitmapFormat8Bit);
+#else
+  s_fb = gbitmap_create_blank(GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT), GBitmapFormat1Bit);
+#endif
+  // The frame buffer belongs to the system, not the app heap
+  s_heap_used = s_heap_peak = 0;
+  s_ctx.fb = s_fb;
+}
+
+static TimeUnits units_changed(const struct tm *before, const struct tm *now)
+{
+  TimeUnits units = SECOND_UNIT;
+  if (now->tm_min != before->tm_min || now->tm_hour != before->tm_hour || now->tm_yday != before->tm_yday) units |= MINUTE_UNIT;
+  if (now->tm_hour != before->tm_hour || now->tm_yday != before->tm_yday) units |= HOUR_UNIT;
+  if (now->tm_yday != before->tm_yday) units |= DAY_UNIT;
+  if (now->tm_mon != before->tm_mon) units |= MONTH_UNIT;
+  if (now->tm_year != before->tm_year) units |= YEAR_UNIT;
+  return units;
+}
+
+// A minute has passed: the tick, and a movement update if there were steps
+static void minute_boundary()
+{
+  time_t now = stub_time(NULL);
+  time_t before = now - SECONDS_PER_MINUTE;
+  struct tm before_tm = *localtime(&before);
+  struct tm *now_tm = localtime(&now);
+  TimeUnits units = units_changed(&before_tm, now_tm);
+
+  if (s_tick_handler && (units & s_tick_units)) {
+    s_tick_handler(now_tm, units);
+    render();
+  }
+
+  if (s_health_handler && (units & DAY_UNIT)) {
+    s_health_handler(HealthEventSignificantUpdate, s_health_context);
+    render();
+  } else if (s_health_handler && s_world->steps(before) > 0) {
+    s_health_handler(HealthEventMovementUpdate, s_health_context);
+    render();
+  }
+}
+
+void stub_run_until(int64_t end_ms)
+{
+  render();
+  while (s_now_ms < end_ms) {
+    if (s_health_subscribed_ms >= 0) {
+      s_health_subscribed_ms = -1;
+      if (s_health_handler) s_health_handler(HealthEventSignificantUpdate, s_health_context);
+      render();
+    }
+
+    // Timers due on a minute boundary fire before its tick
+    if (s_timers && s_timers->at_ms <= s_next_minute_ms && s_timers->at_ms <= end_ms) {
+      AppTimer *timer = s_timers;
+      s_timers = timer->next;
+      if (timer->at_ms > s_now_ms) s_now_ms = timer->at_ms;
+      if (timer->counted) stub_counts[STUB_TIMER]++;
+      AppTimerCallback callback = timer->callback;
+      void *data = timer->data;
+      free(timer);
+      callback(data);
+      render();
+      continue;
+    }
+
+    if (s_next_minute_ms > end_ms) {
+      s_now_ms = end_ms;
+      break;
+    }
+    s_now_ms = s_next_minute_ms;
+    s_next_minute_ms += 60000;
+    minute_boundary();
+  }
+}
@@ -0,0 +1,327 @@
+#pragma once
+/*
+ * Host stand-in for the Pebble SDK header, enough of it to build the watch
+ * sources on Linux for the benchmarks and the simulation in this directory.
+ * Platform macros follow basalt unless STUB_APLITE or STUB_DIORITE is
+ * defined. The services are fakes driven by a simulated clock, see
+ * stub/pebble.c and sim.c.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <locale.h>
+
+#if defined(STUB_APLITE)
+#define PBL_PLATFORM_APLITE 1
+#define PBL_BW 1
+#elif defined(STUB_DIORITE)
+#define PBL_PLATFORM_DIORITE 1
+#define PBL_BW 1
+#define PBL_HEALTH 1
+#else
+#define PBL_PLATFORM_BASALT 1
+#define PBL_COLOR 1
+#define PBL_HEALTH 1
+#endif
+
+#define PBL_DISPLAY_WIDTH 144
+#define PBL_DISPLAY_HEIGHT 168
+
+/* Trigonometry */
+#define TRIG_MAX_RATIO 0xffff
+#define TRIG_MAX_ANGLE 0x10000
+#define DEG_TO_TRIGANGLE(angle) (((angle) * TRIG_MAX_ANGLE) / 360)
+#define TRIGANGLE_TO_DEG(trig_angle) (((trig_angle) * 360) / TRIG_MAX_ANGLE)
+
+int32_t sin_lookup(int32_t angle);
+int32_t cos_lookup(int32_t angle);
+int32_t atan2_lookup(int16_t y, int16_t x);
+
+/* Time, time() reads the simulated clock */
+#define SECONDS_PER_MINUTE 60
+#define SECONDS_PER_HOUR 3600
+#define SECONDS_PER_DAY 86400
+#define MINUTES_PER_HOUR 60
+
+typedef enum {
+  SECOND_UNIT = 1 << 0,
+  MINUTE_UNIT = 1 << 1,
+  HOUR_UNIT = 1 << 2,
+  DAY_UNIT = 1 << 3,
+  MONTH_UNIT = 1 << 4,
+  YEAR_UNIT = 1 << 5
+} TimeUnits;
+
+typedef void (*TickHandler)(struct tm *tick_time, TimeUnits units_changed);
+
+time_t stub_time(time_t *tloc);
+#define time(tloc) stub_time(tloc)
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms);
+time_t time_start_of_today(void);
+bool clock_is_24h_style(void);
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+void tick_timer_service_unsubscribe(void);
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data);
+void app_timer_cancel(AppTimer *timer);
+
+void app_event_loop(void);
+
+/* Memory, the watch code allocates through these so the heap can be counted */
+void *stub_malloc(size_t size);
+void stub_free(void *ptr);
+#define malloc(size) stub_malloc(size)
+#define free(ptr) stub_free(ptr)
+size_t heap_bytes_used(void);
+size_t heap_bytes_free(void);
+
+/* Storage */
+#define PERSIST_DATA_MAX_LENGTH 256
+#define E_DOES_NOT_EXIST (-6)
+typedef int32_t status_t;
+
+int persist_read_data(uint32_t key, void *buffer, size_t buffer_size);
+int persist_write_data(uint32_t key, const void *data, size_t size);
+bool persist_exists(uint32_t key);
+status_t persist_delete(uint32_t key);
+
+/* Graphics */
+typedef struct { int16_t x, y; } GPoint;
+typedef struct { int16_t w, h; } GSize;
+typedef struct { GPoint origin; GSize size; } GRect;
+#define GPoint(x, y) ((GPoint){ (x), (y) })
+#define GSize(w, h) ((GSize){ (w), (h) })
+#define GRect(x, y, w, h) ((GRect){ { (x), (y) }, { (w), (h) } })
+#define GRectZero GRect(0, 0, 0, 0)
+
+typedef union { uint8_t argb; } GColor8;
+typedef GColor8 GColor;
+#define GColorClear ((GColor8){ 0x00 })
+#define GColorBlack ((GColor8){ 0xC0 })
+#define GColorWhite ((GColor8){ 0xFF })
+#define GColorRed ((GColor8){ 0xF0 })
+#define GColorMagenta ((GColor8){ 0xF3 })
+#define GColorShockingPink ((GColor8){ 0xF7 })
+#define GColorVividCerulean ((GColor8){ 0xCB })
+#define GColorPictonBlue ((GColor8){ 0xDB })
+#define GColorMalachite ((GColor8){ 0xDD })
+#define GColorDarkGray ((GColor8){ 0xD5 })
+#define GColorLightGray ((GColor8){ 0xEA })
+#if defined(PBL_COLOR)
+#define COLOR_FALLBACK(color, bw) (color)
+#else
+#define COLOR_FALLBACK(color, bw) (bw)
+#endif
+static inline bool gcolor_equal(GColor8 a, GColor8 b) { return a.argb == b.argb; }
+
+typedef enum { GTextAlignmentLeft, GTextAlignmentCenter, GTextAlignmentRight } GTextAlignment;
+typedef enum { GTextOverflowModeWordWrap, GTextOverflowModeTrailingEllipsis, GTextOverflowModeFill } GTextOverflowMode;
+typedef enum { GCornerNone = 0 } GCornerMask;
+typedef enum { GOvalScaleModeFitCircle, GOvalScaleModeFillCircle } GOvalScaleMode;
+typedef enum { GCompOpAssign, GCompOpAssignInverted, GCompOpOr, GCompOpAnd, GCompOpClear, GCompOpSet } GCompOp;
+typedef enum {
+  GBitmapFormat1Bit,
+  GBitmapFormat8Bit,
+  GBitmapFormat1BitPalette,
+  GBitmapFormat2BitPalette,
+  GBitmapFormat4BitPalette
+} GBitmapFormat;
+
+typedef struct GContext GContext;
+typedef struct GBitmap GBitmap;
+typedef struct { uint8_t *data; int16_t min_x, max_x; } GBitmapDataRowInfo;
+typedef struct StubFont *GFont;
+typedef struct StubResource *ResHandle;
+
+#define FONT_KEY_GOTHIC_18_BOLD "RESOURCE_ID_GOTHIC_18_BOLD"
+#define FONT_KEY_GOTHIC_24_BOLD "RESOURCE_ID_GOTHIC_24_BOLD"
+#define FONT_KEY_LECO_42_NUMBERS "RESOURCE_ID_LECO_42_NUMBERS"
+#define RESOURCE_ID_PIXELS_49 1
+
+ResHandle resource_get_handle(uint32_t resource_id);
+GFont fonts_get_system_font(const char *font_key);
+GFont fonts_load_custom_font(ResHandle handle);
+void fonts_unload_custom_font(GFont font);
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_stroke_color(GContext *ctx, GColor color);
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width);
+void graphics_context_set_text_color(GContext *ctx, GColor color);
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode);
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask);
+void graphics_fill_radial(GContext *ctx, GRect rect, GOvalScaleMode scale_mode, uint16_t inset, int32_t angle_start, int32_t angle_end);
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1);
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode, GTextAlignment alignment, void *text_attributes);
+GSize graphics_text_layout_get_content_size(const char *text, GFont font, GRect box, GTextOverflowMode overflow_mode, GTextAlignment alignment);
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+GBitmap *graphics_capture_frame_buffer(GContext *ctx);
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer);
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format);
+GBitmap *gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor *palette, bool free_on_destroy);
+void gbitmap_destroy(GBitmap *bitmap);
+uint8_t *gbitmap_get_data(const GBitmap *bitmap);
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap);
+GRect gbitmap_get_bounds(const GBitmap *bitmap);
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds);
+GColor *gbitmap_get_palette(const GBitmap *bitmap);
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y);
+
+/* Windows and layers */
+typedef struct Window Window;
+typedef struct Layer Layer;
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+typedef void (*WindowHandler)(Window *window);
+typedef struct {
+  WindowHandler load;
+  WindowHandler appear;
+  WindowHandler disappear;
+  WindowHandler unload;
+} WindowHandlers;
+
+Window *window_create(void);
+void window_destroy(Window *window);
+void window_set_window_handlers(Window *window, WindowHandlers handlers);
+void window_stack_push(Window *window, bool animated);
+Layer *window_get_root_layer(const Window *window);
+
+Layer *layer_create(GRect frame);
+void layer_destroy(Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_add_child(Layer *parent, Layer *child);
+void layer_mark_dirty(Layer *layer);
+GRect layer_get_bounds(const Layer *layer);
+GRect layer_get_frame(const Layer *layer);
+void layer_set_hidden(Layer *layer, bool hidden);
+
+typedef struct TextLayer TextLayer;
+TextLayer *text_layer_create(GRect frame);
+void text_layer_destroy(TextLayer *text_layer);
+Layer *text_layer_get_layer(TextLayer *text_layer);
+void text_layer_set_text(TextLayer *text_layer, const char *text);
+void text_layer_set_font(TextLayer *text_layer, GFont font);
+void text_layer_set_text_color(TextLayer *text_layer, GColor color);
+void text_layer_set_background_color(TextLayer *text_layer, GColor color);
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment);
+
+/* Services */
+typedef struct {
+  uint8_t charge_percent;
+  bool is_charging;
+  bool is_plugged;
+} BatteryChargeState;
+typedef void (*BatteryStateHandler)(BatteryChargeState charge);
+BatteryChargeState battery_state_service_peek(void);
+void battery_state_service_subscribe(BatteryStateHandler handler);
+
+typedef void (*ConnectionHandler)(bool connected);
+typedef struct {
+  ConnectionHandler pebble_app_connection_handler;
+  ConnectionHandler pebblekit_connection_handler;
+} ConnectionHandlers;
+bool connection_service_peek_pebble_app_connection(void);
+void connection_service_subscribe(ConnectionHandlers handlers);
+
+typedef enum { ACCEL_AXIS_X, ACCEL_AXIS_Y, ACCEL_AXIS_Z } AccelAxisType;
+typedef void (*AccelTapHandler)(AccelAxisType axis, int32_t direction);
+void accel_tap_service_subscribe(AccelTapHandler handler);
+
+void vibes_double_pulse(void);
+
+/* Health */
+typedef enum {
+  HealthMetricStepCount,
+  HealthMetricActiveSeconds,
+  HealthMetricWalkedDistanceMeters,
+  HealthMetricSleepSeconds
+} HealthMetric;
+typedef enum {
+  HealthServiceTimeScopeOnce,
+  HealthServiceTimeScopeWeekly,
+  HealthServiceTimeScopeDailyWeekdayOrWeekend,
+  HealthServiceTimeScopeDaily
+} HealthServiceTimeScope;
+typedef enum {
+  HealthEventSignificantUpdate,
+  HealthEventMovementUpdate,
+  HealthEventSleepUpdate,
+  HealthEventMetricAlert,
+  HealthEventHeartRateUpdate
+} HealthEventType;
+typedef enum {
+  HealthActivityNone = 0,
+  HealthActivitySleep = 1 << 0,
+  HealthActivityRestfulSleep = 1 << 1,
+  HealthActivityWalk = 1 << 2,
+  HealthActivityRun = 1 << 3
+} HealthActivity;
+typedef uint32_t HealthActivityMask;
+typedef int32_t HealthValue;
+typedef struct {
+  uint8_t steps;
+  uint8_t orientation;
+  uint16_t vmc;
+  bool is_invalid;
+  uint8_t light;
+} HealthMinuteData;
+typedef void (*HealthEventHandler)(HealthEventType event, void *context);
+
+HealthValue health_service_sum_today(HealthMetric metric);
+HealthValue health_service_sum_averaged(HealthMetric metric, time_t time_start, time_t time_end, HealthServiceTimeScope scope);
+HealthActivityMask health_service_peek_current_activities(void);
+uint32_t health_service_get_minute_history(HealthMinuteData *minute_data, uint32_t max_records, time_t *time_start, time_t *time_end);
+bool health_service_events_subscribe(HealthEventHandler handler, void *context);
+bool health_service_events_unsubscribe(void);
+
+/* AppMessage */
+typedef enum {
+  APP_MSG_OK = 0,
+  APP_MSG_SEND_REJECTED = 1 << 3,
+  APP_MSG_BUSY = 1 << 10
+} AppMessageResult;
+typedef enum { TUPLE_BYTE_ARRAY, TUPLE_CSTRING, TUPLE_UINT, TUPLE_INT } TupleType;
+typedef struct {
+  uint32_t key;
+  TupleType type;
+  uint16_t length;
+  union {
+    int32_t int32;
+    uint32_t uint32;
+    char cstring[32];
+  } value[1];
+} Tuple;
+typedef struct DictionaryIterator DictionaryIterator;
+typedef void (*AppMessageInboxReceived)(DictionaryIterator *iterator, void *context);
+
+extern const uint32_t MESSAGE_KEY_Latitude;
+extern const uint32_t MESSAGE_KEY_Longitude;
+extern const uint32_t MESSAGE_KEY_LatitudeE6;
+extern const uint32_t MESSAGE_KEY_LongitudeE6;
+extern const uint32_t MESSAGE_KEY_PhoneBattery;
+extern const uint32_t MESSAGE_KEY_PhoneBatteryCharging;
+
+AppMessageResult app_message_open(uint32_t size_inbound, uint32_t size_outbound);
+void app_message_register_inbox_received(AppMessageInboxReceived received_callback);
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator);
+AppMessageResult app_message_outbox_send(void);
+Tuple *dict_find(const DictionaryIterator *iter, uint32_t key);
+int dict_write_int(DictionaryIterator *iter, uint32_t key, const void *integer, uint8_t width_bytes, bool is_signed);
+uint32_t dict_write_end(DictionaryIterator *iter);
+
+/* Logging */
+typedef enum {
+  APP_LOG_LEVEL_ERROR = 1,
+  APP_LOG_LEVEL_WARNING = 50,
+  APP_LOG_LEVEL_INFO = 100,
+  APP_LOG_LEVEL_DEBUG = 200
+} AppLogLevel;
+
+// Logs at or above the verbosity go to stderr, errors only by default
+extern AppLogLevel stub_log_level;
+#define APP_LOG(level, fmt, ...) \
+  do { if ((level) <= stub_log_level) fprintf(stderr, fmt "\n", ##__VA_ARGS__); } while (0)
@@ -0,0 +1,62 @@
+#pragma once
+/*
+ * The driver side of the stub SDK: the simulated clock, the world the
+ * services report on and the counts of the calls the watch code makes.
+ */
+#include "pebble.h"
+
+typedef enum {
+  STUB_FRAME,           // Frames rendered, every layer is redrawn in each
+  STUB_DRAW,            // Layer update procs run
+  STUB_GRAPHICS,        // graphics_* drawing calls
+  STUB_MARK_DIRTY,      // layer_mark_dirty calls
+  STUB_HEALTH_QUERY,    // health_service_* calls other than subscribing
+  STUB_MESSAGE_SEND,    // app_message_outbox_send calls
+  STUB_MESSAGE_RECEIVE, // Messages delivered to the inbox handler
+  STUB_PERSIST_WRITE,   // persist_write_data and persist_delete calls
+  STUB_PERSIST_BYTES,   // Bytes written by them
+  STUB_TIMER,           // App timers fired
+  STUB_COUNT_COUNT
+} StubCount;
+
+extern uint32_t stub_counts[STUB_COUNT_COUNT];
+
+struct DictionaryIterator {
+  Tuple tuples[8];
+  int count;
+};
+
+typedef struct {
+  int (*steps)(time_t minute);                          // Steps taken in the minute starting then
+  bool (*asleep)(time_t at);                            // Whether the wearer is asleep then
+  void (*outbox)(const DictionaryIterator *iterator);   // The phone receiving a message
+} StubWorld;
+
+/**
+ * Start the clock and the services
+ *
+ * @param start      The time to start at
+ * @param heap_bytes The app heap of the platform
+ * @param world      The wearer and phone the services report on
+ */
+void stub_start(time_t start, size_t heap_bytes, const StubWorld *world);
+
+int64_t stub_now_ms(void);
+
+/**
+ * Run the event loop up to a time: timers, ticks and health events are
+ * delivered in order, and a frame is rendered after each if a layer is dirty
+ */
+void stub_run_until(int64_t end_ms);
+
+// Run a world event at a time, like an app timer but not counted as one
+void stub_schedule(int64_t at_ms, AppTimerCallback callback, void *data);
+
+// World events, delivered to the app at once
+void stub_set_battery(BatteryChargeState state);
+void stub_set_connected(bool connected);
+void stub_tap(void);
+void stub_inbox(const DictionaryIterator *iterator);
+int dict_write_cstring(DictionaryIterator *iter, uint32_t key, const char *value);
+
+size_t stub_heap_peak(void);
@@ -0,0 +1,117 @@
+/*
+ * Accuracy and cost of the integer sun solver against calcSun in double
+ * precision. calcSunEventsFixed solves several zeniths from one set of solar
+ * terms at 6h and one at 18h; calcSunDayEventsFixed, which the sun table is
+ * built with, is its single zenith case, and every day is checked to come
+ * out the same from both. Errors are over |lat| <= 60 every degree and the
+ * polar mismatches over |lat| <= 89, both every 15 degrees of longitude and
+ * every day of 2015. A day is polar for the reference when either event is,
+ * as the solver and the sun table have it, and a mismatch is a day the two
+ * sides do not agree on.
+ */
+#include <pebble.h>
+#include "utilities.h"
+#include "bench.h"
+
+#define ZENITHS 4
+#define TIMING_CALLS 200000
+
+static const double s_zeniths[ZENITHS] = { ZENITH_OFFICIAL, ZENITH_CIVIL, ZENITH_NAUTICAL, ZENITH_ASTRONOMICAL };
+static const int32_t s_zenith_angles[ZENITHS] = { ZENITH_OFFICIAL_ANGLE, ZENITH_CIVIL_ANGLE, ZENITH_NAUTICAL_ANGLE, ZENITH_ASTRONOMICAL_ANGLE };
+
+typedef struct {
+  double max, sum;
+  int count, polar;
+} SunError;
+
+static void add_day(SunError *error, int lat, const double *ref, const SunEvents *events)
+{
+  bool polar = events->kind != SUN_EVENTS_RISE_SET;
+  bool ref_polar = ref[0] == 0 || ref[1] == 0;
+  if (polar || ref_polar) {
+    error->polar += polar != ref_polar;
+    return;
+  }
+  if (lat < -60 || lat > 60) return;
+
+  for (int set = 0; set < 2; set++) {
+    double e = bench_minutes_apart(set ? events->set : events->rise, ref[set] * 60);
+    if (e > error->max) error->max = e;
+    error->sum += e;
+    error->count++;
+  }
+}
+
+static bool same_events(const SunEvents *a, const SunEvents *b)
+{
+  return a->kind == b->kind && a->rise == b->rise && a->set == b->set;
+}
+
+static void run_accuracy()
+{
+  SunError error[ZENITHS] = { { 0 } };
+  int differ[ZENITHS] = { 0 };
+
+  for (int lat = -89; lat <= 89; lat++)
+    for (int lon = -180; lon <= 180; lon += 15)
+      for (int yday = 1; yday <= 365; yday++) {
+        int month, mday;
+        // 2015 is not a leap year, skip the 29th of February of the leap table
+        bench_month_day(yday < 60 ? yday : yday + 1, &month, &mday);
+        int32_t latitude = DEG_TO_TRIGANGLE(lat);
+        int32_t longitude = DEG_TO_TRIGANGLE(lon);
+
+        SunEvents events[ZENITHS];
+        calcSunEventsFixed(yday, latitude, longitude, s_zenith_angles, ZENITHS, events);
+        for (int k = 0; k < ZENITHS; k++) {
+          SunEvents day_events;
+          calcSunDayEventsFixed(yday, latitude, longitude, s_zenith_angles[k], &day_events);
+          double ref[2];
+          for (int set = 0; set < 2; set++) ref[set] = ref_sun(2015, month, mday, lat, lon, set, s_zeniths[k]);
+          add_day(&error[k], lat, ref, &events[k]);
+          differ[k] += !same_events(&events[k], &day_events);
+        }
+      }
+
+  printf("%-8s %-9s %-9s %-7s %s\n", "zenith", "max min", "mean min", "polar", "days differing from calcSunDayEventsFixed");
+  for (int k = 0; k < ZENITHS; k++)
+    printf("%-8.2f %-9.2f %-9.2f %-7d %d\n", s_zeniths[k], error[k].max, error[k].sum / error[k].count, error[k].polar, differ[k]);
+}
+
+static void run_timing()
+{
+  SunEvents events[ZENITHS];
+  int acc = 0;
+
+  double start = bench_now_ns();
+  for (int i = 0; i < TIMING_CALLS; i++) {
+    calcSunDayEventsFixed(i % 365 + 1, DEG_TO_TRIGANGLE(i % 120 - 60), DEG_TO_TRIGANGLE(i % 360 - 180), ZENITH_OFFICIAL_ANGLE, events);
+    acc += events[0].rise;
+  }
+  double day_ns = (bench_now_ns() - start) / TIMING_CALLS;
+
+  start = bench_now_ns();
+  for (int i = 0; i < TIMING_CALLS; i++) {
+    for (int k = 0; k < ZENITHS; k++)
+      calcSunDayEventsFixed(i % 365 + 1, DEG_TO_TRIGANGLE(i % 120 - 60), DEG_TO_TRIGANGLE(i % 360 - 180), s_zenith_angles[k], &events[k]);
+    acc += events[ZENITHS - 1].rise;
+  }
+  double day4_ns = (bench_now_ns() - start) / TIMING_CALLS;
+
+  start = bench_now_ns();
+  for (int i = 0; i < TIMING_CALLS; i++) {
+    calcSunEventsFixed(i % 365 + 1, DEG_TO_TRIGANGLE(i % 120 - 60), DEG_TO_TRIGANGLE(i % 360 - 180), s_zenith_angles, ZENITHS, events);
+    acc += events[ZENITHS - 1].rise;
+  }
+  double events4_ns = (bench_now_ns() - start) / TIMING_CALLS;
+  bench_sink = acc;
+
+  printf("rise and set: one zenith %.0f ns, %d zeniths one at a time %.0f ns, in one calcSunEventsFixed %.0f ns\n", day_ns, ZENITHS, day4_ns, events4_ns);
+}
+
+int main(void)
+{
+  run_accuracy();
+  run_timing();
+  return 0;
+}
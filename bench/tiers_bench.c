@@ -0,0 +1,124 @@
+/*
+ * Error and cost of each precision tier of the float helpers, the numbers
+ * in the comments of utilities.c. The *_tier functions are static, so
+ * utilities.c is built into this file rather than linked. calcSun only has
+ * the tier it was built with (SUN_PRECISION), the Makefile builds this once
+ * per tier and `tiers_bench sun` prints just its line.
+ */
+#include "utilities.c"
+#include "bench.h"
+
+#define ERROR_SAMPLES 2000000
+#define TIMING_INPUTS 4096
+#define TIMING_ROUNDS 1000
+#define TIERS 3
+
+typedef float (*Kernel)(float);
+
+// One function per tier, so the tier is a constant inside each as on the watch
+#define TIERED(name) \
+  static float name##_fast(float x) { return name(x, MATH_FAST); } \
+  static float name##_balanced(float x) { return name(x, MATH_BALANCED); } \
+  static float name##_accurate(float x) { return name(x, MATH_ACCURATE); } \
+  static const Kernel name##_tiers[TIERS] = { name##_fast, name##_balanced, name##_accurate };
+
+TIERED(sqrt_tier)
+TIERED(sin_tier)
+TIERED(atan_tier)
+TIERED(acos_tier)
+TIERED(sin_core)
+TIERED(cos_core)
+TIERED(asin_core)
+TIERED(atan_core)
+
+static double ref_sqrt(double x) { return sqrt(x); }
+
+static double max_error(Kernel kernel, double (*ref)(double), double lo, double hi, bool relative)
+{
+  double max = 0;
+  for (int i = 0; i < ERROR_SAMPLES; i++) {
+    double x = lo + (hi - lo) * i / (ERROR_SAMPLES - 1);
+    double r = ref((float)x);
+    double e = fabs(kernel((float)x) - r);
+    if (relative && r != 0) e /= fabs(r);
+    if (e > max) max = e;
+  }
+  return max;
+}
+
+static double cost_ns(Kernel kernel, double lo, double hi)
+{
+  static float inputs[TIMING_INPUTS];
+  for (int i = 0; i < TIMING_INPUTS; i++) inputs[i] = lo + (hi - lo) * i / (TIMING_INPUTS - 1);
+  float acc = 0;
+  double start = bench_now_ns();
+  for (int k = 0; k < TIMING_ROUNDS; k++)
+    for (int i = 0; i < TIMING_INPUTS; i++) acc += kernel(inputs[i]);
+  bench_sink = acc;
+  return (bench_now_ns() - start) / ((double)TIMING_ROUNDS * TIMING_INPUTS);
+}
+
+static void run_tiers(const char *name, const Kernel *tiers, double (*ref)(double), double lo, double hi, bool relative, bool timed)
+{
+  char range[32];
+  snprintf(range, sizeof(range), "[%g, %g]", lo, hi);
+  printf("%-10s %-22s %-4s", name, range, relative ? "rel" : "abs");
+  for (int t = 0; t < TIERS; t++) printf(" %8.1e", max_error(tiers[t], ref, lo, hi, relative));
+  if (timed) {
+    printf("  ");
+    for (int t = 0; t < TIERS; t++) printf(" %5.1f", cost_ns(tiers[t], lo, hi));
+  }
+  printf("\n");
+}
+
+/* calcSun against the double reference for |lat| <= 65, official and civil zenith */
+static void run_calc_sun()
+{
+  static const float zeniths[2] = { ZENITH_OFFICIAL, ZENITH_CIVIL };
+  double max = 0, sum = 0;
+  int count = 0;
+
+  for (int z = 0; z < 2; z++)
+    for (int lat = -65; lat <= 65; lat++)
+      for (int lon = -180; lon < 180; lon += 15)
+        for (int yday = 1; yday <= 366; yday += 2) {
+          int month, day;
+          bench_month_day(yday, &month, &day);
+          for (int set = 0; set < 2; set++) {
+            double r = ref_sun(2016, month, day, lat, lon, set, zeniths[z]);
+            float v = calcSun(2016, month, day, lat, lon, set, zeniths[z]);
+            if (r == 0 || v == 0) continue;
+            double e = bench_minutes_apart(v * 60, r * 60);
+            if (e > max) max = e;
+            sum += e;
+            count++;
+          }
+        }
+
+  enum { CALLS = 200000 };
+  float acc = 0;
+  double start = bench_now_ns();
+  for (int i = 0; i < CALLS; i++) acc += calcSun(2016, i % 12 + 1, i % 28 + 1, i % 130 - 65, i % 360 - 180, i & 1, ZENITH_OFFICIAL);
+  double ns = (bench_now_ns() - start) / CALLS;
+  bench_sink = acc;
+
+  static const char *names[TIERS] = { "MATH_FAST", "MATH_BALANCED", "MATH_ACCURATE" };
+  printf("calcSun with SUN_PRECISION %-13s max %.3f min mean %.4f min %6.1f ns\n", names[SUN_PRECISION], max, sum / count, ns);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2 || strcmp(argv[1], "sun") != 0) {
+    printf("%-10s %-22s %-4s %8s %8s %8s   ns: fast / bal / acc\n", "", "range", "err", "fast", "balanced", "accurate");
+    run_tiers("sqrt", sqrt_tier_tiers, ref_sqrt, 1e-3, 1e4, true, true);
+    run_tiers("sin", sin_tier_tiers, sin, -50, 50, false, true);
+    run_tiers("atan", atan_tier_tiers, atan, -100, 100, false, true);
+    run_tiers("acos", acos_tier_tiers, acos, -1, 1, false, true);
+    run_tiers("sin_core", sin_core_tiers, sin, 1e-6, M_PI / 4, true, false);
+    run_tiers("cos_core", cos_core_tiers, cos, -M_PI / 4, M_PI / 4, false, false);
+    run_tiers("asin_core", asin_core_tiers, asin, 1e-6, 0.5625, true, false);
+    run_tiers("atan_core", atan_core_tiers, atan, 0, 1, false, false);
+  }
+  run_calc_sun();
+  return 0;
+}
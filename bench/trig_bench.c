@@ -0,0 +1,86 @@
+/*
+ * Error of the integer trig in utilities.c against libm, and its cost next
+ * to the float kernels it replaces in the sun solver.
+ */
+#include <pebble.h>
+#include "utilities.h"
+#include "bench.h"
+
+#define TO_RADIANS (2 * M_PI / TRIG_MAX_ANGLE)
+#define TIMING_INPUTS 4096
+#define TIMING_ROUNDS 2000
+
+static void run_errors()
+{
+  double e_sin = 0, e_cos = 0, e_tan = 0, e_atan2 = 0, e_asin = 0, e_acos = 0;
+
+  // More than a turn either way, the angle wraps
+  for (int a = -70000; a < 140000; a++) {
+    e_sin = fmax(e_sin, fabs(my_isin(a) - sin(a * TO_RADIANS) * TRIG_MAX_RATIO));
+    e_cos = fmax(e_cos, fabs(my_icos(a) - cos(a * TO_RADIANS) * TRIG_MAX_RATIO));
+    if (fabs(cos(a * TO_RADIANS)) > 0.1)
+      e_tan = fmax(e_tan, fabs(my_itan(a) / (double)TRIG_MAX_RATIO - tan(a * TO_RADIANS)));
+  }
+
+  // Points around circles of growing radius
+  for (int i = 0; i < 2000000; i++) {
+    double theta = i * 2 * M_PI / 2000000;
+    int32_t r = 1000 + i % 70000;
+    int32_t y = lround(r * sin(theta)), x = lround(r * cos(theta));
+    double expected = atan2(y, x);
+    if (expected < 0) expected += 2 * M_PI;
+    double e = fabs(my_iatan2(y, x) - expected / TO_RADIANS);
+    if (e > TRIG_MAX_ANGLE / 2) e = TRIG_MAX_ANGLE - e;
+    e_atan2 = fmax(e_atan2, e);
+  }
+
+  for (int x = -TRIG_MAX_RATIO; x <= TRIG_MAX_RATIO; x++) {
+    double v = x / (double)TRIG_MAX_RATIO;
+    if (fabs(v) >= 0.999) continue;
+    e_asin = fmax(e_asin, fabs(my_iasin(x) - asin(v) / TO_RADIANS));
+    e_acos = fmax(e_acos, fabs(my_iacos(x) - acos(v) / TO_RADIANS));
+  }
+
+  printf("my_isin   max %.1f / TRIG_MAX_RATIO\n", e_sin);
+  printf("my_icos   max %.1f / TRIG_MAX_RATIO\n", e_cos);
+  printf("my_itan   max %.2e abs (|cos| > 0.1)\n", e_tan);
+  printf("my_iatan2 max %.2f TRIG_MAX_ANGLE units\n", e_atan2);
+  printf("my_iasin  max %.2f TRIG_MAX_ANGLE units (|x| < 0.999)\n", e_asin);
+  printf("my_iacos  max %.2f TRIG_MAX_ANGLE units (|x| < 0.999)\n", e_acos);
+}
+
+static int32_t angles[TIMING_INPUTS];
+static float radians[TIMING_INPUTS];
+
+#define TIME(name, expr) \
+  { \
+    double acc = 0, start = bench_now_ns(); \
+    for (int k = 0; k < TIMING_ROUNDS; k++) \
+      for (int i = 0; i < TIMING_INPUTS; i++) acc += (expr); \
+    bench_sink = acc; \
+    printf("%-10s %6.2f ns\n", name, (bench_now_ns() - start) / ((double)TIMING_ROUNDS * TIMING_INPUTS)); \
+  }
+
+static void run_timings()
+{
+  for (int i = 0; i < TIMING_INPUTS; i++) {
+    angles[i] = (i * 37) & (TRIG_MAX_ANGLE - 1);
+    radians[i] = angles[i] * TO_RADIANS;
+  }
+
+  TIME("my_isin", my_isin(angles[i]));
+  TIME("my_sin", my_sin(radians[i]));
+  TIME("my_itan", my_itan(angles[i]));
+  TIME("my_tan", my_tan(radians[i]));
+  TIME("my_iatan2", my_iatan2(angles[i] - 30000, angles[(i + 7) % TIMING_INPUTS] - 30000));
+  TIME("my_atan", my_atan(radians[i] - 3));
+  TIME("my_iacos", my_iacos(angles[i] * 2 - TRIG_MAX_RATIO));
+  TIME("my_acos", my_acos(radians[i] / 3.2f - 1));
+}
+
+int main(void)
+{
+  run_errors();
+  run_timings();
+  return 0;
+}
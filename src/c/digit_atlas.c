@@ -0,0 +1,132 @@
+/*
+ * Digit glyphs blitted from an atlas instead of rasterized from a font. There
+ * is no off-screen graphics context, so the digits are drawn once into the
+ * frame buffer (before the frame's own drawing) and read back from there.
+ */
+#include <pebble.h>
+#include "digit_atlas.h"
+
+// Palettized bitmaps are colour only
+#if defined(PBL_COLOR)
+
+/**
+ * Render the digits of a font and keep them as an atlas. The area of the
+ * frame buffer used is left white.
+ *
+ * @param atlas  The atlas to fill in
+ * @param ctx    The context of an update proc, before it has drawn anything
+ * @param font   The font to render
+ * @param area   Where the digits can be drawn, wrapping onto more rows if needed
+ * @param height The height of a digit, as the text frame it is drawn in
+ * @return Whether the atlas could be made
+ */
+bool digit_atlas_create(DigitAtlas *atlas, GContext *ctx, GFont font, GRect area, int16_t height)
+{
+  char digit[2] = "0";
+  GPoint at[10];
+  int x = 0, y = 0, total = 0;
+
+  atlas->bitmap = NULL;
+  atlas->height = height;
+
+  // Lay the digits out in rows across the area
+  for (int i = 0; i < 10; i++) {
+    digit[0] = '0' + i;
+    int w = graphics_text_layout_get_content_size(digit, font, GRect(0, 0, area.size.w, height), GTextOverflowModeWordWrap, GTextAlignmentLeft).w;
+    if (x + w > area.size.w) {
+      x = 0;
+      y += height;
+    }
+    if (w <= 0 || w > area.size.w || y + height > area.size.h) return false;
+
+    at[i] = GPoint(area.origin.x + x, area.origin.y + y);
+    atlas->offsets[i] = total;
+    atlas->widths[i] = w;
+    x += w;
+    total += w;
+  }
+
+  GColor *palette = malloc(2 * sizeof(GColor));
+  if (!palette) return false;
+  palette[0] = GColorClear;
+  palette[1] = GColorBlack;
+  atlas->bitmap = gbitmap_create_blank_with_palette(GSize(total, height), GBitmapFormat1BitPalette, palette, true);
+  if (!atlas->bitmap) {
+    free(palette);
+    return false;
+  }
+
+  GRect used = GRect(area.origin.x, area.origin.y, area.size.w, y + height);
+  graphics_context_set_fill_color(ctx, GColorWhite);
+  graphics_fill_rect(ctx, used, 0, GCornerNone);
+  graphics_context_set_text_color(ctx, GColorBlack);
+  for (int i = 0; i < 10; i++) {
+    digit[0] = '0' + i;
+    graphics_draw_text(ctx, digit, font, GRect(at[i].x, at[i].y, atlas->widths[i], height), GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
+  }
+
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) {
+    digit_atlas_destroy(atlas);
+    return false;
+  }
+
+  uint8_t *data = gbitmap_get_data(atlas->bitmap);
+  uint16_t stride = gbitmap_get_bytes_per_row(atlas->bitmap);
+  for (int i = 0; i < 10; i++) {
+    for (int row = 0; row < height; row++) {
+      GBitmapDataRowInfo info = gbitmap_get_data_row_info(fb, at[i].y + row);
+      uint8_t *dst = data + row * stride;
+      for (int col = 0; col < atlas->widths[i]; col++) {
+        int fx = at[i].x + col;
+        if (fx < info.min_x || fx > info.max_x || info.data[fx] == GColorWhite.argb) continue;
+        // Leftmost pixel in the most significant bit
+        int bit = atlas->offsets[i] + col;
+        dst[bit >> 3] |= 0x80 >> (bit & 7);
+      }
+    }
+  }
+  graphics_release_frame_buffer(ctx, fb);
+
+  graphics_fill_rect(ctx, used, 0, GCornerNone);
+  return true;
+}
+
+void digit_atlas_destroy(DigitAtlas *atlas)
+{
+  if (atlas->bitmap) gbitmap_destroy(atlas->bitmap);
+  atlas->bitmap = NULL;
+}
+
+/**
+ * Draw digits centred in a frame, anything else in the text is skipped
+ *
+ * @param ctx   The context
+ * @param atlas The digits
+ * @param text  The text to draw
+ * @param frame The frame to centre the text in
+ * @param color The colour of the text
+ */
+void digit_atlas_draw(GContext *ctx, const DigitAtlas *atlas, const char *text, GRect frame, GColor color)
+{
+  int width = 0;
+  for (const char *p = text; *p; p++) {
+    if (*p >= '0' && *p <= '9') width += atlas->widths[*p - '0'];
+  }
+
+  gbitmap_get_palette(atlas->bitmap)[1] = color;
+  graphics_context_set_compositing_mode(ctx, GCompOpSet);
+
+  int x = frame.origin.x + (frame.size.w - width) / 2;
+  for (const char *p = text; *p; p++) {
+    if (*p < '0' || *p > '9') continue;
+    int i = *p - '0';
+    gbitmap_set_bounds(atlas->bitmap, GRect(atlas->offsets[i], 0, atlas->widths[i], atlas->height));
+    graphics_draw_bitmap_in_rect(ctx, atlas->bitmap, GRect(x, frame.origin.y, atlas->widths[i], atlas->height));
+    x += atlas->widths[i];
+  }
+
+  graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+}
+
+#endif
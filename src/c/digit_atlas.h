@@ -0,0 +1,13 @@
+#pragma once
+
+// The digits of a font rendered once into a 1 bit palettized bitmap, side by side
+typedef struct {
+  GBitmap *bitmap;        // Palette is clear and the text colour
+  int16_t offsets[10];    // Left edge of each digit in the bitmap
+  int16_t widths[10];
+  int16_t height;
+} DigitAtlas;
+
+bool digit_atlas_create(DigitAtlas *atlas, GContext *ctx, GFont font, GRect area, int16_t height);
+void digit_atlas_destroy(DigitAtlas *atlas);
+void digit_atlas_draw(GContext *ctx, const DigitAtlas *atlas, const char *text, GRect frame, GColor color);
@@ -0,0 +1,141 @@
+/*
+ * Step data without health queries on the minute path. Today's steps are
+ * re-read only when the health service reports movement, and the averages
+ * come from a per-hour curve that is built once a day and kept in persistent
+ * storage.
+ */
+#include <pebble.h>
+#include "persist_keys.h"
+#include "health_cache.h"
+#include "perf.h"
+
+#if defined(PBL_HEALTH)
+
+#define HOURS_PER_DAY 24
+
+typedef struct {
+  int32_t day;                         // time_start_of_today() the curve is for
+  int32_t curve[HOURS_PER_DAY + 1];    // Average steps by the start of each hour
+} HealthAverages;
+
+static HealthAverages s_averages;
+static int s_steps = 0;
+static HealthCacheHandler s_handler;
+
+static int read_steps()
+{
+  perf_count(PERF_HEALTH_QUERY);
+  return (int)health_service_sum_today(HealthMetricStepCount);
+}
+
+static void build_averages(time_t start)
+{
+  s_averages.day = start;
+  s_averages.curve[0] = 0;
+  for (int h = 0; h < HOURS_PER_DAY; h++) {
+    time_t from = start + h * SECONDS_PER_HOUR;
+    perf_count(PERF_HEALTH_QUERY);
+    int steps = (int)health_service_sum_averaged(HealthMetricStepCount, from, from + SECONDS_PER_HOUR, HealthServiceTimeScopeDailyWeekdayOrWeekend);
+    s_averages.curve[h + 1] = s_averages.curve[h] + (steps > 0 ? steps : 0);
+  }
+  persist_write_data(PERSIST_KEY_HEALTH_AVERAGES, &s_averages, sizeof(s_averages));
+}
+
+/**
+ * Make sure the averages are for today, loading or building them if not
+ */
+static void check_day()
+{
+  time_t start = time_start_of_today();
+  if (s_averages.day == start) return;
+
+  if (persist_read_data(PERSIST_KEY_HEALTH_AVERAGES, &s_averages, sizeof(s_averages)) == sizeof(s_averages) && s_averages.day == start)
+    return;
+
+  build_averages(start);
+  // The day changed as well, so today's steps start again
+  s_steps = read_steps();
+}
+
+static void health_handler(HealthEventType event, void *context)
+{
+  switch (event) {
+    case HealthEventSignificantUpdate:
+      // Also sent right after subscribing. A time change moves the start of
+      // today, which check_day catches, so the curve is only rebuilt then.
+    case HealthEventMovementUpdate:
+      check_day();
+      s_steps = read_steps();
+      break;
+    default:
+      return;
+  }
+
+  if (s_handler) s_handler();
+}
+
+void health_cache_init(HealthCacheHandler handler)
+{
+  s_handler = handler;
+  check_day();
+  s_steps = read_steps();
+  health_service_events_subscribe(health_handler, NULL);
+}
+
+void health_cache_deinit()
+{
+  health_service_events_unsubscribe();
+}
+
+int health_cache_steps()
+{
+  return s_steps;
+}
+
+int health_cache_day_average()
+{
+  check_day();
+  return s_averages.curve[HOURS_PER_DAY];
+}
+
+/**
+ * The average steps by a time of day, interpolated within the hour
+ *
+ * @param minutes Minutes since midnight
+ */
+int health_cache_average_now(int minutes)
+{
+  check_day();
+  int h = minutes / MINUTES_PER_HOUR;
+  if (h >= HOURS_PER_DAY) return s_averages.curve[HOURS_PER_DAY];
+  int m = minutes % MINUTES_PER_HOUR;
+  return s_averages.curve[h] + (s_averages.curve[h + 1] - s_averages.curve[h]) * m / MINUTES_PER_HOUR;
+}
+
+#else
+
+// No health service on this platform, no steps and no averages
+void health_cache_init(HealthCacheHandler handler)
+{
+}
+
+void health_cache_deinit()
+{
+}
+
+int health_cache_steps()
+{
+  return 0;
+}
+
+int health_cache_day_average()
+{
+  return 0;
+}
+
+int health_cache_average_now(int minutes)
+{
+  return 0;
+}
+
+#endif
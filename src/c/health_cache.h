@@ -0,0 +1,9 @@
+#pragma once
+
+typedef void (*HealthCacheHandler)(void);
+
+void health_cache_init(HealthCacheHandler handler);
+void health_cache_deinit();
+int health_cache_steps();
+int health_cache_day_average();
+int health_cache_average_now(int minutes);
@@ -1,33 +1,140 @@
 #include <pebble.h>
 #include "utilities.h"
+#include "sun_table.h"
+#include "ring.h"
+#include "health_cache.h"
+#include "step_history.h"
+#include "perf.h"
+#include "digit_atlas.h"
+#include "persist_keys.h"
 // Default value
 #define STEPS_DEFAULT 1000
 
+#define MINUTES_PER_DAY 1440
+
 // Piece Sizing
 #define SUB_TEXT_HEIGHT 30
 #define TITLE_TEXT_HEIGHT 49
 #define PIE_THICKNESS 10
 #define NUMBER_OF_COLOURS 7
-
-static AppSync s_sync;
+#define STEPS_NOW_THICKNESS (PIE_THICKNESS * 3 / 10)
+// The steps rings move in ticks of this many degrees, like the minute marks of a dial
+#define STEPS_ANGLE_DEGREES 6
+
+// Layout, fixed by the display of the platform
+#define SCREEN_WIDTH PBL_DISPLAY_WIDTH
+#define SCREEN_HEIGHT PBL_DISPLAY_HEIGHT
+#define SCREEN_FRAME GRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT)
+#define HOUR_RING_FRAME GRect(SCREEN_WIDTH >> 3, SCREEN_HEIGHT >> 3, (3 * SCREEN_WIDTH) >> 2, (3 * SCREEN_HEIGHT) >> 2)
+#define MINUTE_RING_FRAME GRect(PIE_THICKNESS, PIE_THICKNESS, SCREEN_WIDTH - (PIE_THICKNESS << 1), SCREEN_HEIGHT - (PIE_THICKNESS << 1))
+#define HOUR_TEXT_FRAME GRect(0, SUB_TEXT_HEIGHT, SCREEN_WIDTH, TITLE_TEXT_HEIGHT)
+#define MINUTE_TEXT_FRAME GRect(0, SUB_TEXT_HEIGHT + TITLE_TEXT_HEIGHT, SCREEN_WIDTH, TITLE_TEXT_HEIGHT)
+#define TOP_TEXT_FRAME GRect(0, -5, SCREEN_WIDTH, SUB_TEXT_HEIGHT)
+#define TOP_SUB_TEXT_FRAME GRect(0, SUB_TEXT_HEIGHT - 13, SCREEN_WIDTH, SUB_TEXT_HEIGHT)
+#define BOTTOM_TEXT_FRAME GRect(0, SCREEN_HEIGHT - SUB_TEXT_HEIGHT, SCREEN_WIDTH, SUB_TEXT_HEIGHT)
+#define BOTTOM_SUB_TEXT_FRAME GRect(0, SCREEN_HEIGHT - SUB_TEXT_HEIGHT - 13, SCREEN_WIDTH, SUB_TEXT_HEIGHT)
+
+// Colours, the black and white platforms draw the rings in black
+#define HOUR_COLOUR COLOR_FALLBACK(GColorMagenta, GColorBlack)
+#define MINUTE_COLOUR COLOR_FALLBACK(GColorPictonBlue, GColorBlack)
+#define STEPS_COLOUR COLOR_FALLBACK(GColorShockingPink, GColorBlack)
+#define STEPS_GOAL_COLOUR COLOR_FALLBACK(GColorMalachite, GColorBlack)
+#define STEPS_NOW_COLOUR COLOR_FALLBACK(GColorVividCerulean, GColorBlack)
+#define DISCONNECTED_COLOUR COLOR_FALLBACK(GColorRed, GColorLightGray)
+
+/*
+ * Heap budget of the window, measure it with PERF_HEAP in perf.h. The peaks
+ * are from a simulated day of `make -C bench sim-<platform>`, whose layers and
+ * bitmaps are near but not exactly the firmware's sizes.
+ * basalt  (64 KB): ring cache 24192 B (8 bit), ring spans 2080 B, PIXELS_49,
+ *                  peak 27.0 KB (28.2 KB with TIME_DIGIT_ATLAS)
+ * diorite (64 KB): ring cache 3360 B (1 bit), PIXELS_49, peak 4.1 KB
+ * aplite  (24 KB): ring cache 3360 B (1 bit), system font, no health so no
+ *                  step history or steps text, peak 3.7 KB
+ * The aplite 24 KB also holds the code and .bss, about 11.0 KB and 1.9 KB
+ * (1098 B of it the sun table) built for aplite with host gcc -Os, which
+ * leaves some 8 KB spare. That is with the host-only solvers of utilities.c
+ * compiled out (HOST_SOLVERS), they would take another 4.9 KB.
+ * The ring cache is only created when HEAP_RESERVE is left after it.
+ */
+#define HEAP_RESERVE 4096
+
+#if defined(PBL_COLOR)
+// Draw the rings straight into the frame buffer rather than with graphics_fill_radial
+#define SCANLINE_RINGS 1
+#define RING_CACHE_FORMAT GBitmapFormat8Bit
+#define RING_CACHE_BYTES (SCREEN_WIDTH * SCREEN_HEIGHT)
+#else
+// The spans write 8 bit pixels, the black and white frame buffers are 1 bit
+#define SCANLINE_RINGS 0
+#define RING_CACHE_FORMAT GBitmapFormat1Bit
+#define RING_CACHE_BYTES (((SCREEN_WIDTH + 31) / 32) * 4 * SCREEN_HEIGHT)
+#endif
+
+#if defined(PBL_PLATFORM_APLITE)
+// The custom font does not fit the aplite heap next to everything else
+#define TIME_FONT_CUSTOM 0
+#else
+#define TIME_FONT_CUSTOM 1
+#endif
+
+// Render the time digits once into an atlas on the first frame and unload the
+// font. Off until device numbers show a win, the host sim only shows its cost
+// (about 1.5 KB more heap, a blit per glyph). Colour platforms with the
+// custom font can turn it on from the build flags.
+#ifndef TIME_DIGIT_ATLAS
+#define TIME_DIGIT_ATLAS 0
+#endif
+#if TIME_DIGIT_ATLAS && !(TIME_FONT_CUSTOM && defined(PBL_COLOR))
+#undef TIME_DIGIT_ATLAS
+#define TIME_DIGIT_ATLAS 0
+#endif
 
 static Window *s_main_window;
 
-static GFont s_time_font;
+static GFont s_time_font, s_large_font, s_small_font;
+#if TIME_DIGIT_ATLAS
+static DigitAtlas time_digits;
+static bool time_digits_tried = false;
+#endif
 
 static Layer *background_layer;
 static Layer *steps_layer;
 static Layer *hour_layer, *minute_layer;
 
-static TextLayer *battery_text_layer, *location_text_layer;
-
-static TextLayer *steps_text_layer, *steps_now_average_text_layer, *steps_average_text_layer;
-
-static TextLayer *time_hour_text_layer, *time_minute_text_layer, *date_text_layer, *day_text_layer;
+static RingSpans hour_ring, minute_ring;
+#if defined(PBL_HEALTH)
+static RingSpans steps_ring, steps_now_ring;
+#endif
+
+// All the text is drawn by one layer, the time always and the rest for a while after a tap
+enum {
+  INFO_HOUR,
+  INFO_MINUTE,
+  INFO_DATE,
+  INFO_DAY,
+  INFO_STEPS,
+  INFO_STEPS_NOW,
+  INFO_STEPS_PERCENT,
+  INFO_BATTERY,
+  INFO_PHONE_BATTERY,
+  INFO_TEXTS
+};
+
+typedef struct {
+  const char *text;
+  GFont font;
+  GRect frame;
+  GTextAlignment alignment;
+} InfoText;
+
+static Layer *info_layer;
+static InfoText info_texts[INFO_TEXTS];
+static bool info_shown = false;
 
 static int current_hour = -1, current_minute, current_time_minutes;
 
-static int current_steps = 0, steps_day_average, steps_average_now;
+static int current_steps = 0, steps_day_average = STEPS_DEFAULT, steps_average_now;
 
 static int battery_level;
 static int phone_battery = -1;
@@ -35,18 +142,88 @@ static bool bluetooth_connected = false, battery_charging = false, phone_battery
 
 static bool dayTime = true;
 
-static double lat = 0.0, lon = 0.0;
-static int sunriseMinutes = 0, sunsetMinutes = 1500;
+// Location in micro degrees
+static int32_t lat = 0, lon = 0;
+// Sunrise and sunset in local minutes of the day, counted as day until the sun table has today
+static SunEvents sun_events = { .kind = SUN_EVENTS_POLAR_DAY };
+static int sun_yday = -1;   // Day the sun events are for
+static int tz_minutes = 0;
 static bool locked = false;
 
+// Bumped when the snapshot layout changes, older snapshots are ignored
+#define STATE_VERSION 2
+#define STATE_PHONE_CHARGING 0x01
+
+// What the first frame needs, saved when it changes so a launch does not wait for the phone
+typedef struct __attribute__((__packed__)) {
+  uint8_t version;
+  uint8_t flags;
+  int8_t phone_battery;       // -1 when unknown
+  int16_t sun_yday;           // Day the sun events are for, -1 for none
+  uint8_t sun_kind;           // SunEventsKind
+  int16_t sunrise_minutes;    // Local minutes of the day, only for SUN_EVENTS_RISE_SET
+  int16_t sunset_minutes;
+  int32_t lat, lon;           // Micro degrees
+  int32_t steps_day_average;
+} State;
+
+static State saved_state;
+
+// Low power runs on hourly ticks with the minutes hidden and no redraws
+typedef enum {
+  POWER_MODE_ACTIVE,
+  POWER_MODE_LOW,
+  POWER_MODES
+} PowerMode;
+
+// How often the active mode checks whether the wearer is resting
+#define POWER_CHECK_MINUTES 10
+// At night, this long without steps counts as the watch being off the wrist
+#define OFF_WRIST_MINUTES 60
+
+static PowerMode power_mode = POWER_MODE_ACTIVE;
+static time_t power_mode_since;
+static uint32_t power_mode_seconds[POWER_MODES];
+
+// What each layer was last drawn with, only layers whose inputs changed get marked dirty
+typedef struct {
+  int hour;
+  int minute;
+  int32_t steps_angle;
+  int32_t steps_now_angle;
+  bool bluetooth;
+  bool day;
+} RenderState;
+
+enum {
+  REDRAW_BACKGROUND,
+  REDRAW_HOUR,
+  REDRAW_MINUTE,
+  REDRAW_STEPS,
+  REDRAW_INFO,
+  REDRAW_LAYERS
+};
+
+static RenderState last_drawn = { .hour = -1, .minute = -1, .steps_angle = -1, .steps_now_angle = -1 };
+
+// The composed background, hour and steps rings, reused while their inputs stay the same
+static GBitmap *ring_cache;
+static RenderState ring_cache_state, ring_frame_state;
+static bool ring_cache_valid = false, ring_cache_drawn = false;
+
+static char hour_buffer[4];
+static char minute_buffer[4];
+#if defined(PBL_HEALTH)
+static char steps_text_buffer[25];
 static char steps_buffer[10];
 static char steps_perc_buffer[10];
 static char steps_now_buffer[10];
 static char steps_average_buffer[10];
-static char date_buffer[10];
-static char day_buffer[5];
+#endif
+static char date_buffer[12];
+static char day_buffer[8];
 static char battery_buffer[8];
-static char phone_battery_buffer[10];
+static char phone_battery_buffer[14];
 
 static void main_window_load(Window *window);
 static void main_window_unload(Window *window);
@@ -58,16 +235,162 @@ static void bluetooth_update_proc(Layer *layer, GContext *ctx);
 static void steps_proc_layer(Layer *layer, GContext *ctx);
 static void time_hour_update_proc(Layer *layer, GContext *ctx);
 static void time_minute_update_proc(Layer *layer, GContext *ctx);
+static void info_update_proc(Layer *layer, GContext *ctx);
+// Timed versions of the update procs when PERF_PROFILE is set
+PERF_PROFILED_PROC(bluetooth_update_proc, PERF_BLUETOOTH_PROC)
+PERF_PROFILED_PROC(steps_proc_layer, PERF_STEPS_PROC)
+PERF_PROFILED_PROC(time_hour_update_proc, PERF_HOUR_PROC)
+PERF_PROFILED_PROC(time_minute_update_proc, PERF_MINUTE_PROC)
+PERF_PROFILED_PROC(info_update_proc, PERF_INFO_PROC)
 
 static void tick_handler(struct tm *tick_time, TimeUnits units_changed);
 
-static void add_text_layer(Layer *window_layer, TextLayer *text_layer, GTextAlignment alignment);
+static void add_info_text(int index, const char *text, GFont font, GRect frame, GTextAlignment alignment);
+#if TIME_DIGIT_ATLAS
+static void build_time_digits(GContext *ctx);
+#endif
 static void update_watch();
 static void update_health();
-static void setTextColour();
+static void load_state();
+static void save_state();
+static void schedule_redraw();
+static void mark_for_redraw(int index, Layer *layer);
+static void fill_ring(GContext *ctx, const RingSpans *ring, GRect bounds, uint16_t thickness, int32_t angle_end, GColor color);
+static RenderState current_render_state();
+static bool ring_inputs_equal(const RenderState *a, const RenderState *b);
+static void ring_cache_store(GContext *ctx);
+static int32_t steps_angle(int steps);
 static void battery_update();
 static void show_text();
 static void hide_text();
+static void check_power_mode();
+static void wake_up();
+
+static void update_timezone()
+{
+  time_t temp = time(NULL);
+  struct tm *local_time = localtime(&temp);
+  int local_minutes = local_time->tm_hour * 60 + local_time->tm_min, local_yday = local_time->tm_yday;
+  struct tm *gmt_time = gmtime(&temp);
+
+  // In minutes, some zones are half or quarter hours off UTC
+  int tz = local_minutes - (gmt_time->tm_hour * 60 + gmt_time->tm_min);
+  int days = local_yday - gmt_time->tm_yday;
+
+  // Across new year the day of the year jumps the other way
+  if (days > 1) {
+    days = -1;
+  } else if (days < -1) {
+    days = 1;
+  }
+
+  tz_minutes = tz + days * MINUTES_PER_DAY;
+}
+
+/**
+ * Minutes UTC to local minutes of the day, the local time can fall on the
+ * day before or after
+ *
+ * @param minutes Minutes UTC
+ */
+static int local_day_minutes(int minutes)
+{
+  minutes = (minutes + tz_minutes) % MINUTES_PER_DAY;
+  return minutes < 0 ? minutes + MINUTES_PER_DAY : minutes;
+}
+
+/**
+ * Look up the sunrise and sunset for the day, no-op until the table has it
+ *
+ * @param yday The day of the year
+ */
+static void update_sun_times(int yday)
+{
+  SunEvents events = { .kind = SUN_EVENTS_RISE_SET };
+  if (!locked || !sun_table_lookup(yday, &events)) return;
+
+  if (events.kind == SUN_EVENTS_RISE_SET) {
+    events.rise = local_day_minutes(events.rise);
+    events.set = local_day_minutes(events.set);
+  }
+  sun_events = events;
+  sun_yday = yday;
+}
+
+/**
+ * Whether the sun is up at a minute of the local day
+ *
+ * @param minutes Minutes since local midnight
+ */
+static bool sun_is_up(int minutes)
+{
+  switch (sun_events.kind) {
+    case SUN_EVENTS_POLAR_DAY:
+      return true;
+    case SUN_EVENTS_POLAR_NIGHT:
+      return false;
+    default:
+      // Far from the meridian of the timezone the day wraps past local midnight
+      if (sun_events.rise <= sun_events.set)
+        return minutes >= sun_events.rise && minutes <= sun_events.set;
+      return minutes >= sun_events.rise || minutes <= sun_events.set;
+  }
+}
+
+/**
+ * Restore the snapshot of the last run, so the location, the time of day and
+ * the steps goal are right from the first frame
+ */
+static void load_state()
+{
+  State state;
+  if (persist_read_data(PERSIST_KEY_STATE, &state, sizeof(state)) != sizeof(state) || state.version != STATE_VERSION)
+    return;
+  saved_state = state;
+
+  lat = state.lat;
+  lon = state.lon;
+  phone_battery = state.phone_battery;
+  phone_battery_charging = state.flags & STATE_PHONE_CHARGING;
+  if (state.steps_day_average > 0) steps_day_average = state.steps_day_average;
+
+  // The sun events only hold for the day they were looked up on
+  time_t temp = time(NULL);
+  if (state.sun_yday == localtime(&temp)->tm_yday) {
+    sun_yday = state.sun_yday;
+    sun_events.kind = state.sun_kind;
+    sun_events.rise = state.sunrise_minutes;
+    sun_events.set = state.sunset_minutes;
+  }
+}
+
+/**
+ * Write the snapshot if anything in it changed since the last write. The
+ * phone battery percent changes every few minutes through the day, so it
+ * only goes along with a write for something else (or when it becomes known
+ * or unknown) rather than wearing the flash on its own.
+ */
+static void save_state()
+{
+  State state = {
+    .version = STATE_VERSION,
+    .flags = phone_battery_charging ? STATE_PHONE_CHARGING : 0,
+    .phone_battery = phone_battery,
+    .sun_yday = sun_yday,
+    .sun_kind = sun_events.kind,
+    .sunrise_minutes = sun_events.rise,
+    .sunset_minutes = sun_events.set,
+    .lat = lat,
+    .lon = lon,
+    .steps_day_average = steps_day_average,
+  };
+  State compare = state;
+  if ((phone_battery < 0) == (saved_state.phone_battery < 0)) compare.phone_battery = saved_state.phone_battery;
+  if (memcmp(&compare, &saved_state, sizeof(state)) == 0) return;
+
+  saved_state = state;
+  persist_write_data(PERSIST_KEY_STATE, &state, sizeof(state));
+}
 
 static void update_location()
 {
@@ -78,59 +401,80 @@ static void update_location()
   }
   locked = true;
 
-  time_t temp = time(NULL);
-  struct tm *local_time = localtime(&temp);
-  struct tm *gmt_time = gmtime(&temp);
+  update_timezone();
+  sun_table_update(E6_TO_TRIGANGLE(lat), E6_TO_TRIGANGLE(lon));
 
-  int tz = local_time->tm_hour - gmt_time->tm_hour;
+  update_watch();
+  battery_update();
+}
 
-  if (gmt_time->tm_yday < local_time->tm_yday) {
-    tz += 24;
-  } else if (gmt_time->tm_yday > local_time->tm_yday) {
-    tz -= 24;
+/**
+ * Read a coordinate in micro degrees. Phones send it as an int32, older
+ * phone side scripts as a decimal string on the legacy key.
+ *
+ * @param iter   The message
+ * @param key_e6 The int32 micro degrees key
+ * @param key    The legacy string key
+ * @param value  Set to the coordinate
+ * @return Whether the message had the coordinate
+ */
+static bool read_coordinate(DictionaryIterator *iter, uint32_t key_e6, uint32_t key, int32_t *value)
+{
+  Tuple *tup = dict_find(iter, key_e6);
+  if (tup) {
+    *value = tup->value->int32;
+    return true;
   }
 
-  float sunriseTime = calcSunRise(2016, 10, 28, lat, lon, ZENITH_OFFICIAL) + tz;
-  float sunsetTime = calcSunSet(2016, 10, 28, lat, lon, ZENITH_OFFICIAL) + tz;
-
-  int sunriseHour = (int)sunriseTime;
-  int sunriseMinute = (int)((((int)(sunriseTime*100))%100)*0.6);
-  int sunsetHour = (int)sunsetTime;
-  int sunsetMinute = (int)((((int)(sunsetTime*100))%100)*0.6);
-
-  sunriseMinutes = sunriseHour * 60 + sunriseMinute;
-  sunsetMinutes = sunsetHour * 60 + sunsetMinute;
-  
-  update_watch();
-  battery_update();
+  tup = dict_find(iter, key);
+  if (tup) {
+    *value = (int32_t)round(atof(tup->value->cstring) * 1000000);
+    return true;
+  }
+  return false;
 }
 
 static void inbox_received_callback(DictionaryIterator *iter, void *context) {
   Tuple *tup;
-
-  tup = dict_find(iter, MESSAGE_KEY_Latitude);
-  if(tup) {
-    lat = atof(tup->value->cstring);
-    update_location();
+  bool location_changed = false, battery_changed = false;
+
+  // Apply every tuple first, then recompute once for what actually changed
+  int32_t value;
+  if (read_coordinate(iter, MESSAGE_KEY_LatitudeE6, MESSAGE_KEY_Latitude, &value)) {
+    location_changed |= value != lat;
+    lat = value;
+    perf_count(PERF_INBOX_TUPLE);
   }
 
-  tup = dict_find(iter, MESSAGE_KEY_Longitude);
-  if(tup) {
-    lon = atof(tup->value->cstring);
-    update_location();
+  if (read_coordinate(iter, MESSAGE_KEY_LongitudeE6, MESSAGE_KEY_Longitude, &value)) {
+    location_changed |= value != lon;
+    lon = value;
+    perf_count(PERF_INBOX_TUPLE);
   }
 
   tup = dict_find(iter, MESSAGE_KEY_PhoneBattery);
   if(tup) {
+    battery_changed |= tup->value->int32 != phone_battery;
     phone_battery = tup->value->int32;
-    battery_update();
+    perf_count(PERF_INBOX_TUPLE);
   }
 
   tup = dict_find(iter, MESSAGE_KEY_PhoneBatteryCharging);
   if(tup) {
+    battery_changed |= (tup->value->int32 == 1) != phone_battery_charging;
     phone_battery_charging = tup->value->int32 == 1;
+    perf_count(PERF_INBOX_TUPLE);
+  }
+
+  if (location_changed) {
+    // update_location also refreshes the battery text
+    update_location();
+    perf_count(PERF_INBOX_RECOMPUTE);
+  } else if (battery_changed) {
     battery_update();
+    perf_count(PERF_INBOX_RECOMPUTE);
   }
+  if (location_changed || battery_changed) save_state();
 }
 
 static void request_data(void)
@@ -146,19 +490,35 @@ static void request_data(void)
   dict_write_end(iter);
 
   app_message_outbox_send();
+  perf_count(PERF_MESSAGE_SEND);
 }
 
 static void accel_tap_handler(AccelAxisType axis, int32_t direction)
 {
+  wake_up();
   show_text();
 }
 
+/**
+ * The health cache has new data
+ */
+static void health_update_handler()
+{
+  if (power_mode == POWER_MODE_ACTIVE) {
+    update_health();
+  } else if (health_cache_steps() != current_steps) {
+    // Steps while in low power mean the wearer is up again
+    wake_up();
+  }
+}
+
 /**
  * Main function, the watch runs this function
  */
 int main(void)
 {
   setlocale(LC_ALL, "");
+  format_init();
 
   s_main_window = window_create();
   window_set_window_handlers(s_main_window, (WindowHandlers)
@@ -176,8 +536,12 @@ int main(void)
   app_message_open(64, 64);
   app_message_register_inbox_received(inbox_received_callback);
 
+  sun_table_init(update_watch);
+  health_cache_init(health_update_handler);
+  step_history_init();
+  power_mode_since = time(NULL);
   tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
-  steps_day_average = STEPS_DEFAULT;
+  load_state();
 
   battery_callback(battery_state_service_peek());
   battery_state_service_subscribe(battery_callback);
@@ -189,8 +553,9 @@ int main(void)
 
   app_event_loop();
 
+  sun_table_deinit();
+  health_cache_deinit();
   window_destroy(s_main_window);
-  app_sync_deinit(&s_sync);
 }
 
 /**
@@ -202,72 +567,79 @@ static void main_window_load(Window *window)
 {
   // Get information about the Window
   Layer *window_layer = window_get_root_layer(window);
-  GRect bounds = layer_get_bounds(window_layer);
+  perf_heap_begin(true);
 
   // Create bluetooth meter Layer
-  background_layer = layer_create(bounds);
-  layer_set_update_proc(background_layer, bluetooth_update_proc);
+  background_layer = layer_create(SCREEN_FRAME);
+  layer_set_update_proc(background_layer, PERF_PROC(bluetooth_update_proc));
   layer_add_child(window_layer, background_layer);
+  perf_heap_mark("background_layer");
 
   // Create hour meter Layer
-  hour_layer = layer_create(GRect(bounds.size.w >> 3, bounds.size.h >> 3, (3 * bounds.size.w) >> 2, (3 * bounds.size.h) >> 2));
-  layer_set_update_proc(hour_layer, time_hour_update_proc);
+  hour_layer = layer_create(HOUR_RING_FRAME);
+  layer_set_update_proc(hour_layer, PERF_PROC(time_hour_update_proc));
   layer_add_child(window_layer, hour_layer);
-
-  // Create minute meter Layer
-  minute_layer = layer_create(GRect(PIE_THICKNESS, PIE_THICKNESS, bounds.size.w - (PIE_THICKNESS<<1), bounds.size.h - (PIE_THICKNESS<<1)));
-  layer_set_update_proc(minute_layer, time_minute_update_proc);
-  layer_add_child(window_layer, minute_layer);
+  perf_heap_mark("hour_layer");
 
   // Create steps meter Layer
-  steps_layer = layer_create(bounds);
-  layer_set_update_proc(steps_layer, steps_proc_layer);
+  steps_layer = layer_create(SCREEN_FRAME);
+  layer_set_update_proc(steps_layer, PERF_PROC(steps_proc_layer));
   layer_add_child(window_layer, steps_layer);
+  perf_heap_mark("steps_layer");
 
+  // Create minute meter Layer, above the cached rings as it changes every minute
+  minute_layer = layer_create(MINUTE_RING_FRAME);
+  layer_set_update_proc(minute_layer, PERF_PROC(time_minute_update_proc));
+  layer_add_child(window_layer, minute_layer);
+  perf_heap_mark("minute_layer");
+
+#if SCANLINE_RINGS
+  ring_spans_create(&hour_ring, layer_get_frame(hour_layer), PIE_THICKNESS);
+  ring_spans_create(&minute_ring, layer_get_frame(minute_layer), PIE_THICKNESS);
+#if defined(PBL_HEALTH)
+  ring_spans_create(&steps_ring, layer_get_frame(steps_layer), PIE_THICKNESS);
+  ring_spans_create(&steps_now_ring, layer_get_frame(steps_layer), STEPS_NOW_THICKNESS);
+#endif
+  perf_heap_mark("ring spans");
+#endif
+
+  ring_cache = NULL;
+  if (heap_bytes_free() > RING_CACHE_BYTES + HEAP_RESERVE)
+    ring_cache = gbitmap_create_blank(GSize(SCREEN_WIDTH, SCREEN_HEIGHT), RING_CACHE_FORMAT);
+  ring_cache_valid = false;
+  perf_heap_mark("ring_cache");
+
+#if TIME_FONT_CUSTOM
   s_time_font = fonts_load_custom_font(resource_get_handle(RESOURCE_ID_PIXELS_49));
-
-  // Create the time display
-  time_hour_text_layer = text_layer_create(GRect(0, SUB_TEXT_HEIGHT, bounds.size.w, TITLE_TEXT_HEIGHT));
-  text_layer_set_font(time_hour_text_layer, s_time_font);
-  add_text_layer(window_layer, time_hour_text_layer, GTextAlignmentCenter);
-
-  time_minute_text_layer = text_layer_create(GRect(0, SUB_TEXT_HEIGHT +  TITLE_TEXT_HEIGHT, bounds.size.w, TITLE_TEXT_HEIGHT));
-  text_layer_set_font(time_minute_text_layer, s_time_font);
-  add_text_layer(window_layer, time_minute_text_layer, GTextAlignmentCenter);
-
-  // Create the date display
-  date_text_layer = text_layer_create(GRect(0, -5, bounds.size.w, SUB_TEXT_HEIGHT));
-  text_layer_set_font(date_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  add_text_layer(window_layer, date_text_layer, GTextAlignmentLeft);
-
-  // Create the date display
-  day_text_layer = text_layer_create(GRect(0, SUB_TEXT_HEIGHT - 13, bounds.size.w, SUB_TEXT_HEIGHT));
-  text_layer_set_font(day_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  add_text_layer(window_layer, day_text_layer, GTextAlignmentLeft);
-
-  // Create the steps display
-  steps_text_layer = text_layer_create(GRect(0, bounds.size.h - SUB_TEXT_HEIGHT, bounds.size.w, SUB_TEXT_HEIGHT));
-  text_layer_set_font(steps_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  add_text_layer(window_layer, steps_text_layer, GTextAlignmentCenter);
-
-  // Create the current average steps display
-  steps_now_average_text_layer = text_layer_create(GRect(0, bounds.size.h - SUB_TEXT_HEIGHT - 13, bounds.size.w, SUB_TEXT_HEIGHT));
-  text_layer_set_font(steps_now_average_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  add_text_layer(window_layer, steps_now_average_text_layer, GTextAlignmentLeft);
-
-  // Create the average steps display
-  steps_average_text_layer = text_layer_create(GRect(0, bounds.size.h - SUB_TEXT_HEIGHT - 13, bounds.size.w, SUB_TEXT_HEIGHT));
-  text_layer_set_font(steps_average_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  add_text_layer(window_layer, steps_average_text_layer, GTextAlignmentRight);
-
-  // Create the battery percentage display
-  battery_text_layer = text_layer_create(GRect(0, -5, bounds.size.w, SUB_TEXT_HEIGHT));
-  text_layer_set_font(battery_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  add_text_layer(window_layer, battery_text_layer, GTextAlignmentRight);
-
-  location_text_layer = text_layer_create(GRect(0, SUB_TEXT_HEIGHT - 13, bounds.size.w, SUB_TEXT_HEIGHT));
-  text_layer_set_font(location_text_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
-  add_text_layer(window_layer, location_text_layer, GTextAlignmentRight);
+#if TIME_DIGIT_ATLAS
+  time_digits_tried = false;
+#endif
+#else
+  s_time_font = fonts_get_system_font(FONT_KEY_LECO_42_NUMBERS);
+#endif
+  perf_heap_mark("PIXELS_49");
+
+  s_large_font = fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD);
+  s_small_font = fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD);
+
+  // The texts point at buffers that are updated in place
+  add_info_text(INFO_HOUR, hour_buffer, s_time_font, HOUR_TEXT_FRAME, GTextAlignmentCenter);
+  add_info_text(INFO_MINUTE, minute_buffer, s_time_font, MINUTE_TEXT_FRAME, GTextAlignmentCenter);
+  add_info_text(INFO_DATE, date_buffer, s_large_font, TOP_TEXT_FRAME, GTextAlignmentLeft);
+  add_info_text(INFO_DAY, day_buffer, s_small_font, TOP_SUB_TEXT_FRAME, GTextAlignmentLeft);
+#if defined(PBL_HEALTH)
+  add_info_text(INFO_STEPS, steps_text_buffer, s_large_font, BOTTOM_TEXT_FRAME, GTextAlignmentCenter);
+  add_info_text(INFO_STEPS_NOW, steps_now_buffer, s_small_font, BOTTOM_SUB_TEXT_FRAME, GTextAlignmentLeft);
+  add_info_text(INFO_STEPS_PERCENT, steps_perc_buffer, s_small_font, BOTTOM_SUB_TEXT_FRAME, GTextAlignmentRight);
+#endif
+  add_info_text(INFO_BATTERY, battery_buffer, s_large_font, TOP_TEXT_FRAME, GTextAlignmentRight);
+  add_info_text(INFO_PHONE_BATTERY, phone_battery_buffer, s_small_font, TOP_SUB_TEXT_FRAME, GTextAlignmentRight);
+
+  info_layer = layer_create(SCREEN_FRAME);
+  layer_set_update_proc(info_layer, PERF_PROC(info_update_proc));
+  layer_add_child(window_layer, info_layer);
+  perf_heap_mark("info_layer");
+  perf_heap_end();
 }
 
 /**
@@ -277,22 +649,38 @@ static void main_window_load(Window *window)
  */
 static void main_window_unload(Window *window)
 {
-  text_layer_destroy(time_hour_text_layer);
-  text_layer_destroy(time_minute_text_layer);
-  text_layer_destroy(date_text_layer);
-  text_layer_destroy(day_text_layer);
-  text_layer_destroy(location_text_layer);
+  perf_heap_begin(false);
+  layer_destroy(info_layer);
+  perf_heap_mark("info_layer");
   layer_destroy(hour_layer);
+  perf_heap_mark("hour_layer");
   layer_destroy(minute_layer);
-  fonts_unload_custom_font(s_time_font);
-
-  text_layer_destroy(steps_text_layer);
-  text_layer_destroy(steps_now_average_text_layer);
-  text_layer_destroy(steps_average_text_layer);
+  perf_heap_mark("minute_layer");
+#if TIME_DIGIT_ATLAS
+  digit_atlas_destroy(&time_digits);
+#endif
+#if TIME_FONT_CUSTOM
+  if (s_time_font) fonts_unload_custom_font(s_time_font);
+  s_time_font = NULL;
+  perf_heap_mark("PIXELS_49");
+#endif
   layer_destroy(steps_layer);
-
-  text_layer_destroy(battery_text_layer);
+  perf_heap_mark("steps_layer");
   layer_destroy(background_layer);
+  perf_heap_mark("background_layer");
+#if SCANLINE_RINGS
+  ring_spans_destroy(&hour_ring);
+  ring_spans_destroy(&minute_ring);
+#if defined(PBL_HEALTH)
+  ring_spans_destroy(&steps_ring);
+  ring_spans_destroy(&steps_now_ring);
+#endif
+  perf_heap_mark("ring spans");
+#endif
+  if (ring_cache) gbitmap_destroy(ring_cache);
+  ring_cache = NULL;
+  perf_heap_mark("ring_cache");
+  perf_heap_end();
 }
 
 /**
@@ -309,12 +697,22 @@ static void battery_callback(BatteryChargeState state)
 
 static void battery_update()
 {
-  snprintf(battery_buffer, sizeof(battery_buffer), "%s%d%%", battery_charging ? "+" : "", battery_level);
+  char *end = battery_buffer + sizeof(battery_buffer);
+  char *p = format_append(battery_buffer, end, battery_charging ? "+" : "");
+  p = format_append_number(p, end, battery_level);
+  format_append(p, end, "%");
+
+  end = phone_battery_buffer + sizeof(phone_battery_buffer);
+  p = phone_battery_buffer;
+  *p = '\0';
   if (phone_battery > -1) {
-    snprintf(phone_battery_buffer, sizeof(phone_battery_buffer), "%s%d%% %s", phone_battery_charging ? "+" : "", phone_battery, locked ? (dayTime ? "\U0001F603" : "\U0001F634") : "--");
-  } else {
-    snprintf(phone_battery_buffer, sizeof(phone_battery_buffer), "%s", locked ? (dayTime ? "\U0001F603" : "\U0001F634") : "--");
+    p = format_append(p, end, phone_battery_charging ? "+" : "");
+    p = format_append_number(p, end, phone_battery);
+    p = format_append(p, end, "% ");
   }
+  format_append(p, end, locked ? (dayTime ? "\U0001F603" : "\U0001F634") : "--");
+
+  if (info_shown) mark_for_redraw(REDRAW_INFO, info_layer);
 }
 
 /**
@@ -325,7 +723,13 @@ static void battery_update()
 static void bluetooth_callback(bool connected)
 {
   bluetooth_connected = connected;
-  layer_mark_dirty(background_layer);
+  // schedule_redraw waits for the next active tick in low power, up to an
+  // hour, the connection state should show straight away
+  if (power_mode == POWER_MODE_LOW && connected != last_drawn.bluetooth) {
+    last_drawn.bluetooth = connected;
+    mark_for_redraw(REDRAW_BACKGROUND, background_layer);
+  }
+  schedule_redraw();
 
   if(!connected)
     vibes_double_pulse();
@@ -350,8 +754,23 @@ static void tick_handler(struct tm *tick_time, TimeUnits units_changed)
  */
 static void bluetooth_update_proc(Layer *layer, GContext *ctx)
 {
+  perf_count(PERF_DRAW);
+#if TIME_DIGIT_ATLAS
+  // Nothing has been drawn yet in this frame, so the digits can be rendered here
+  if (!time_digits_tried) build_time_digits(ctx);
+#endif
+  // This is the bottom layer, decide here whether the rings come from the cache
+  ring_frame_state = current_render_state();
+  ring_cache_drawn = ring_cache_valid && ring_inputs_equal(&ring_frame_state, &ring_cache_state);
+  if (ring_cache_drawn) {
+    perf_count(PERF_RING_CACHE_HIT);
+    graphics_draw_bitmap_in_rect(ctx, ring_cache, layer_get_bounds(layer));
+    return;
+  }
+  perf_count(PERF_RING_CACHE_MISS);
+
   if (bluetooth_connected && dayTime) return;
-  graphics_context_set_fill_color(ctx, bluetooth_connected ? GColorBlack : GColorRed);
+  graphics_context_set_fill_color(ctx, bluetooth_connected ? GColorBlack : DISCONNECTED_COLOUR);
   graphics_fill_rect(ctx, layer_get_bounds(layer), 0, GCornerNone);
 }
 
@@ -363,13 +782,13 @@ static void bluetooth_update_proc(Layer *layer, GContext *ctx)
  */
 static void time_hour_update_proc(Layer *layer, GContext *ctx)
 {
-  if (!dayTime) return;
+  perf_count(PERF_DRAW);
+  if (ring_cache_drawn || !dayTime) return;
   GRect bounds = layer_get_bounds(layer);
-  graphics_context_set_fill_color(ctx, GColorMagenta);
-  graphics_fill_radial(ctx, bounds, GOvalScaleModeFitCircle, PIE_THICKNESS, 0, (current_hour % 12) * DEG_TO_TRIGANGLE(30));
+  fill_ring(ctx, &hour_ring, bounds, PIE_THICKNESS, (current_hour % 12) * DEG_TO_TRIGANGLE(30), HOUR_COLOUR);
   
   graphics_context_set_stroke_width(ctx, 5);
-  graphics_context_set_stroke_color(ctx, GColorMagenta);
+  graphics_context_set_stroke_color(ctx, HOUR_COLOUR);
   
   int32_t angle = TRIG_MAX_ANGLE * (current_hour % 12) / 12;
   int hw = bounds.size.w>>1;
@@ -386,14 +805,15 @@ static void time_hour_update_proc(Layer *layer, GContext *ctx)
  */
 static void time_minute_update_proc(Layer *layer, GContext *ctx)
 {
-  if (!dayTime) return;
+  perf_count(PERF_DRAW);
+  // Drawn live over the ring cache. Hourly ticks in low power, the minute ring would go stale
+  if (!dayTime || power_mode == POWER_MODE_LOW) return;
   GRect bounds = layer_get_bounds(layer);
-  graphics_context_set_fill_color(ctx, GColorPictonBlue);
-  graphics_fill_radial(ctx, bounds, GOvalScaleModeFitCircle, PIE_THICKNESS, 0, current_minute * DEG_TO_TRIGANGLE(6));
+  fill_ring(ctx, &minute_ring, bounds, PIE_THICKNESS, current_minute * DEG_TO_TRIGANGLE(6), MINUTE_COLOUR);
   
   
   graphics_context_set_stroke_width(ctx, 5);
-  graphics_context_set_stroke_color(ctx, GColorPictonBlue);
+  graphics_context_set_stroke_color(ctx, MINUTE_COLOUR);
   
   int32_t angle = TRIG_MAX_ANGLE * current_minute / 60;
   int hw = bounds.size.w>>1;
@@ -410,17 +830,21 @@ static void time_minute_update_proc(Layer *layer, GContext *ctx)
  */
 static void steps_proc_layer(Layer *layer, GContext *ctx)
 {
-  if (!dayTime) return;
+  perf_count(PERF_DRAW);
+  if (ring_cache_drawn) return;
+  if (!dayTime) {
+    ring_cache_store(ctx);
+    return;
+  }
+#if defined(PBL_HEALTH)
   GRect bounds = layer_get_bounds(layer);
 
-  float l = 1.0f * current_steps / steps_day_average;
+  fill_ring(ctx, &steps_ring, bounds, PIE_THICKNESS, steps_angle(current_steps), current_steps >= steps_day_average ? STEPS_GOAL_COLOUR : STEPS_COLOUR);
+  fill_ring(ctx, &steps_now_ring, bounds, STEPS_NOW_THICKNESS, steps_angle(steps_average_now), STEPS_NOW_COLOUR);
+#endif
 
-  graphics_context_set_fill_color(ctx, l >= 1.0 ? GColorMalachite : GColorShockingPink);
-  graphics_fill_radial(ctx, bounds, GOvalScaleModeFitCircle, PIE_THICKNESS, 0, l * DEG_TO_TRIGANGLE(360));
-
-  l = 1.0f * steps_average_now / steps_day_average;
-  graphics_context_set_fill_color(ctx, GColorVividCerulean);
-  graphics_fill_radial(ctx, bounds, GOvalScaleModeFitCircle, PIE_THICKNESS * 0.3, 0, l * DEG_TO_TRIGANGLE(360));
+  // The steps ring is the top of the cached stack, the minute ring goes over it
+  ring_cache_store(ctx);
 }
 
 /* Watch update for tick: */
@@ -430,8 +854,7 @@ static void steps_proc_layer(Layer *layer, GContext *ctx)
  */
 static void update_watch()
 {
-  static char s_hour_buffer[4];
-  static char s_minute_buffer[4];
+  uint32_t perf_start = perf_time_start();
   int tmp_hour = current_hour;
 
   // Get the current time
@@ -442,106 +865,337 @@ static void update_watch()
   current_hour = tick_time->tm_hour;
   current_minute = tick_time->tm_min;
   current_time_minutes = current_hour * 60 + current_minute;
+  int yday = tick_time->tm_yday;
 
   // Create the string for the time display
-  strftime(s_hour_buffer, sizeof(s_hour_buffer), clock_is_24h_style() ? "%H" : "%I", tick_time);
-  text_layer_set_text(time_hour_text_layer, s_hour_buffer);
-  strftime(s_minute_buffer, sizeof(s_minute_buffer), "%M", tick_time);
-  text_layer_set_text(time_minute_text_layer, s_minute_buffer);
+  int display_hour = current_hour;
+  if (!clock_is_24h_style()) {
+    display_hour = current_hour % 12;
+    if (display_hour == 0) display_hour = 12;
+  }
+  format_two_digits(hour_buffer, display_hour);
+  format_two_digits(minute_buffer, current_minute);
+  mark_for_redraw(REDRAW_INFO, info_layer);
 
   // Create the string for the date display
-  strftime(date_buffer, sizeof(date_buffer), "%d %b", tick_time);
-  strftime(day_buffer, sizeof(day_buffer), "%a", tick_time);
+  format_date(date_buffer, sizeof(date_buffer), tick_time);
+  format_day(day_buffer, sizeof(day_buffer), tick_time);
 
-  if (current_minute & 1) update_health();
+  update_health();
+  // Steps counted by now were taken in the minute that just ended
+  step_history_update(current_time_minutes - 1, current_steps);
 
-  if (current_time_minutes == 1) {
+  // Once a day, on the first tick after midnight
+  if (current_time_minutes == 1 || (power_mode == POWER_MODE_LOW && current_time_minutes == 0)) {
     request_data();
   }
 
-  bool t = current_time_minutes <= sunsetMinutes && current_time_minutes >= sunriseMinutes;
+  if (tmp_hour != current_hour && tmp_hour >= 0) perf_report(tmp_hour);
+
+  // The offset changes with daylight saving, which happens on the hour
+  if (locked && tmp_hour != current_hour) update_timezone();
+  update_sun_times(yday);
+
+  bool t = sun_is_up(current_time_minutes);
 
   if (dayTime != t) {
     dayTime = t;
-    setTextColour();
+    // The text colour follows the time of day
+    mark_for_redraw(REDRAW_INFO, info_layer);
   }
 
-  // Mark the layers as dirty
-  if (tmp_hour != current_hour) layer_mark_dirty(hour_layer);
-  layer_mark_dirty(minute_layer);
-  if (dayTime) {
-    layer_mark_dirty(background_layer);
-  }
+  check_power_mode();
+  save_state();
+  schedule_redraw();
+  perf_time_end(PERF_UPDATE_WATCH, perf_start);
 }
 
+/**
+ * Refresh the step values from the health cache, no health queries here
+ */
 static void update_health()
 {
-  int start = time_start_of_today();
+  uint32_t perf_start = perf_time_start();
+  // Without an average keep the last one, STEPS_DEFAULT until there was one
+  int average = health_cache_day_average();
+  if (average > 0) steps_day_average = average;
 
-  steps_day_average = (int)health_service_sum_averaged(HealthMetricStepCount, start, start + SECONDS_PER_DAY, HealthServiceTimeScopeDailyWeekdayOrWeekend);
-  if (steps_day_average < 1) steps_day_average = STEPS_DEFAULT;
-
-  steps_average_now = (int)health_service_sum_averaged(HealthMetricStepCount, start, time(NULL), HealthServiceTimeScopeDailyWeekdayOrWeekend);
+  steps_average_now = health_cache_average_now(current_time_minutes);
   if (steps_average_now < 1) steps_average_now = STEPS_DEFAULT;
 
-  current_steps = (int)health_service_sum_today(HealthMetricStepCount);
+  current_steps = health_cache_steps();
+
+  schedule_redraw();
+  perf_time_end(PERF_UPDATE_HEALTH, perf_start);
+}
+
+/**
+ * Fill a ring clockwise from 12 o'clock, using the precomputed spans when
+ * they are available
+ *
+ * @param ctx       The context
+ * @param ring      The spans of the ring
+ * @param bounds    The bounds of the layer, for graphics_fill_radial
+ * @param thickness The thickness of the ring
+ * @param angle_end The end angle
+ * @param color     The colour of the ring
+ */
+static void fill_ring(GContext *ctx, const RingSpans *ring, GRect bounds, uint16_t thickness, int32_t angle_end, GColor color)
+{
+#if SCANLINE_RINGS
+  if (ring->spans) {
+    GBitmap *fb = graphics_capture_frame_buffer(ctx);
+    if (fb) {
+      ring_fill(fb, ring, angle_end, color);
+      graphics_release_frame_buffer(ctx, fb);
+      return;
+    }
+  }
+#endif
+  graphics_context_set_fill_color(ctx, color);
+  graphics_fill_radial(ctx, bounds, GOvalScaleModeFitCircle, thickness, 0, angle_end);
+}
+
+/* Render scheduling */
+
+/**
+ * The angle of the steps ring, in STEPS_ANGLE_DEGREES ticks so walking only
+ * redraws the rings (and replaces the ring cache) every few dozen steps
+ *
+ * @param steps The steps to show
+ */
+static int32_t steps_angle(int steps)
+{
+  int degrees = 360 * steps / steps_day_average;
+  return DEG_TO_TRIGANGLE(degrees - degrees % STEPS_ANGLE_DEGREES);
+}
+
+static RenderState current_render_state()
+{
+  return (RenderState) {
+    .hour = current_hour % 12,
+    .minute = power_mode == POWER_MODE_LOW ? -1 : current_minute,   // No minute ring in low power
+    .steps_angle = steps_angle(current_steps),
+    .steps_now_angle = steps_angle(steps_average_now),
+    .bluetooth = bluetooth_connected,
+    .day = dayTime
+  };
+}
+
+/**
+ * Whether two states draw the same cached layers (background, hour and steps
+ * rings), the minute is drawn live over the cache so it is left out
+ */
+static bool ring_inputs_equal(const RenderState *a, const RenderState *b)
+{
+  return a->hour == b->hour &&
+         a->steps_angle == b->steps_angle && a->steps_now_angle == b->steps_now_angle &&
+         a->bluetooth == b->bluetooth && a->day == b->day;
+}
+
+/**
+ * Copy the frame buffer (background and rings so far) into the ring cache
+ *
+ * @param ctx The context
+ */
+static void ring_cache_store(GContext *ctx)
+{
+  if (!ring_cache) return;
+
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) return;
+
+  uint8_t *src = gbitmap_get_data(fb);
+  uint8_t *dst = gbitmap_get_data(ring_cache);
+  uint16_t src_row = gbitmap_get_bytes_per_row(fb);
+  uint16_t dst_row = gbitmap_get_bytes_per_row(ring_cache);
+  uint16_t row = src_row < dst_row ? src_row : dst_row;
+  int h = gbitmap_get_bounds(ring_cache).size.h;
+
+  for (int y = 0; y < h; y++) {
+    memcpy(dst + y * dst_row, src + y * src_row, row);
+  }
+  graphics_release_frame_buffer(ctx, fb);
+
+  ring_cache_state = ring_frame_state;
+  ring_cache_valid = true;
+}
+
+/* Power modes */
+
+/**
+ * Whether the wearer is asleep, or at night the watch has not seen a step
+ * for long enough to be off the wrist
+ */
+static bool wearer_resting()
+{
+#if defined(PBL_HEALTH)
+  perf_count(PERF_HEALTH_QUERY);
+  HealthActivityMask activities = health_service_peek_current_activities();
+  if (activities & (HealthActivitySleep | HealthActivityRestfulSleep)) return true;
+
+  return !dayTime && current_time_minutes >= OFF_WRIST_MINUTES &&
+         step_history_sum(current_time_minutes - OFF_WRIST_MINUTES, current_time_minutes) == 0;
+#else
+  return false;
+#endif
+}
+
+static void set_power_mode(PowerMode mode)
+{
+  if (mode == power_mode) return;
+
+  time_t now = time(NULL);
+  power_mode_seconds[power_mode] += now - power_mode_since;
+  power_mode_since = now;
+  power_mode = mode;
+
+  tick_timer_service_subscribe(mode == POWER_MODE_LOW ? HOUR_UNIT : MINUTE_UNIT, tick_handler);
+  // The minute digits and ring are hidden in low power
+  mark_for_redraw(REDRAW_INFO, info_layer);
+  mark_for_redraw(REDRAW_MINUTE, minute_layer);
+
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "power mode %d: %d s active, %d s low so far", (int)mode, (int)power_mode_seconds[POWER_MODE_ACTIVE], (int)power_mode_seconds[POWER_MODE_LOW]);
+}
+
+/**
+ * Run on every tick, low power is checked every tick (hourly) and active
+ * every POWER_CHECK_MINUTES, staying at least that long after waking
+ */
+static void check_power_mode()
+{
+  if (power_mode == POWER_MODE_ACTIVE) {
+    if (current_minute % POWER_CHECK_MINUTES != 0) return;
+    if (time(NULL) - power_mode_since < POWER_CHECK_MINUTES * SECONDS_PER_MINUTE) return;
+  }
+  set_power_mode(wearer_resting() ? POWER_MODE_LOW : POWER_MODE_ACTIVE);
+}
+
+/**
+ * Back to active straight away, on a tap or steps
+ */
+static void wake_up()
+{
+  if (power_mode == POWER_MODE_ACTIVE) return;
+  set_power_mode(POWER_MODE_ACTIVE);
+  update_watch();
+}
 
-  layer_mark_dirty(steps_layer);
+static void mark_for_redraw(int index, Layer *layer)
+{
+  // The mark counters are in REDRAW_* order
+  perf_count(PERF_MARK_BACKGROUND + index);
+  layer_mark_dirty(layer);
+}
+
+/**
+ * Mark dirty only the layers whose inputs changed since they were last drawn
+ */
+static void schedule_redraw()
+{
+  // Nothing is redrawn in low power, the next active tick catches up
+  if (power_mode == POWER_MODE_LOW) return;
+
+  RenderState now = current_render_state();
+
+  bool day_changed = now.day != last_drawn.day;
+
+  if (day_changed || now.bluetooth != last_drawn.bluetooth)
+    mark_for_redraw(REDRAW_BACKGROUND, background_layer);
+
+  // The rings are not drawn at night, only the switch matters then
+  if (day_changed || (now.day && now.hour != last_drawn.hour))
+    mark_for_redraw(REDRAW_HOUR, hour_layer);
+  if (day_changed || (now.day && now.minute != last_drawn.minute))
+    mark_for_redraw(REDRAW_MINUTE, minute_layer);
+  if (day_changed || (now.day && (now.steps_angle != last_drawn.steps_angle || now.steps_now_angle != last_drawn.steps_now_angle)))
+    mark_for_redraw(REDRAW_STEPS, steps_layer);
+
+  last_drawn = now;
 }
 
 /* Helper functions */
 
-static void add_text_layer(Layer *window_layer, TextLayer *text_layer, GTextAlignment alignment)
+static void add_info_text(int index, const char *text, GFont font, GRect frame, GTextAlignment alignment)
 {
-  text_layer_set_background_color(text_layer, GColorClear);
-  text_layer_set_text_color(text_layer, GColorBlack);
-  text_layer_set_text_alignment(text_layer, alignment);
-  layer_add_child(window_layer, text_layer_get_layer(text_layer));
+  info_texts[index] = (InfoText) {
+    .text = text,
+    .font = font,
+    .frame = frame,
+    .alignment = alignment
+  };
 }
 
-static void setTextColour()
+#if TIME_DIGIT_ATLAS
+/**
+ * Render the time digits into the atlas and drop the font, keeping the font
+ * if the atlas cannot be made
+ *
+ * @param ctx The context of the bottom layer
+ */
+static void build_time_digits(GContext *ctx)
 {
-  text_layer_set_text_color(time_hour_text_layer, dayTime ? GColorBlack : GColorWhite);
-  text_layer_set_text_color(time_minute_text_layer, dayTime ? GColorBlack : GColorWhite);
-  text_layer_set_text_color(date_text_layer, dayTime ? GColorBlack : GColorWhite);
-  text_layer_set_text_color(day_text_layer, dayTime ? GColorBlack : GColorWhite);
-  text_layer_set_text_color(location_text_layer, dayTime ? GColorBlack : GColorWhite);
-  text_layer_set_text_color(steps_text_layer, dayTime ? GColorBlack : GColorWhite);
-  text_layer_set_text_color(steps_now_average_text_layer, dayTime ? GColorBlack : GColorWhite);
-  text_layer_set_text_color(steps_average_text_layer, dayTime ? GColorBlack : GColorWhite);
-  text_layer_set_text_color(battery_text_layer, dayTime ? GColorBlack : GColorWhite);
-  layer_mark_dirty(background_layer);
+  time_digits_tried = true;
+  size_t before = heap_bytes_used();
+  if (!digit_atlas_create(&time_digits, ctx, s_time_font, SCREEN_FRAME, TITLE_TEXT_HEIGHT)) return;
+
+  size_t with_atlas = heap_bytes_used();
+  fonts_unload_custom_font(s_time_font);
+  s_time_font = NULL;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "digit atlas %d B, time font %d B", (int)(with_atlas - before), (int)(with_atlas - heap_bytes_used()));
+}
+#endif
+
+/**
+ * Draw the time, and the other texts while they are shown
+ *
+ * @param layer The layer to update
+ * @param ctx   The context
+ */
+static void info_update_proc(Layer *layer, GContext *ctx)
+{
+  perf_count(PERF_DRAW);
+  GColor colour = dayTime ? GColorBlack : GColorWhite;
+  graphics_context_set_text_color(ctx, colour);
+
+  int count = info_shown ? INFO_TEXTS : INFO_DATE;
+  for (int i = 0; i < count; i++) {
+    const InfoText *info = &info_texts[i];
+    if (!info->text || !info->text[0]) continue;
+    if (i == INFO_MINUTE && power_mode == POWER_MODE_LOW) continue;
+#if TIME_DIGIT_ATLAS
+    if ((i == INFO_HOUR || i == INFO_MINUTE) && time_digits.bitmap) {
+      digit_atlas_draw(ctx, &time_digits, info->text, info->frame, colour);
+      continue;
+    }
+#endif
+    graphics_draw_text(ctx, info->text, info->font, info->frame, GTextOverflowModeWordWrap, info->alignment, NULL);
+  }
 }
 
 static void show_text()
 {
-  static char steps[25];
-  
+#if defined(PBL_HEALTH)
+  char *end = steps_text_buffer + sizeof(steps_text_buffer);
+
   format_number(steps_buffer, sizeof(steps_buffer), current_steps);
   format_number(steps_average_buffer, sizeof(steps_average_buffer), steps_day_average);
   format_number(steps_now_buffer, sizeof(steps_now_buffer), steps_average_now);
-  snprintf(steps, sizeof(steps), "%s / %s", steps_buffer, steps_average_buffer);
-  snprintf(steps_perc_buffer, sizeof(steps_perc_buffer), "%d%%", (int)(100.0f * current_steps / steps_day_average));
-  
-  text_layer_set_text(steps_text_layer, steps);
-  text_layer_set_text(steps_now_average_text_layer, steps_now_buffer);
-  text_layer_set_text(steps_average_text_layer, steps_perc_buffer); //steps_average_buffer
-  
-  text_layer_set_text(date_text_layer, date_buffer);
-  text_layer_set_text(day_text_layer, day_buffer);
-  
-  text_layer_set_text(location_text_layer, phone_battery_buffer);
-  text_layer_set_text(battery_text_layer, battery_buffer);
+  char *p = format_append(steps_text_buffer, end, steps_buffer);
+  p = format_append(p, end, " / ");
+  format_append(p, end, steps_average_buffer);
+
+  p = format_append_number(steps_perc_buffer, steps_perc_buffer + sizeof(steps_perc_buffer), 100 * current_steps / steps_day_average);
+  format_append(p, steps_perc_buffer + sizeof(steps_perc_buffer), "%");
+#endif
+
+  info_shown = true;
+  mark_for_redraw(REDRAW_INFO, info_layer);
   app_timer_register(10000, hide_text, NULL);
 }
 
 static void hide_text()
 {
-  text_layer_set_text(steps_text_layer, NULL);
-  text_layer_set_text(steps_now_average_text_layer, NULL);
-  text_layer_set_text(steps_average_text_layer, NULL);
-  text_layer_set_text(date_text_layer, NULL);
-  text_layer_set_text(day_text_layer, NULL);
-  text_layer_set_text(location_text_layer, NULL);
-  text_layer_set_text(battery_text_layer, NULL);
+  info_shown = false;
+  mark_for_redraw(REDRAW_INFO, info_layer);
 }
@@ -0,0 +1,149 @@
+/*
+ * Counters of the work the watchface does and histograms of how long it
+ * takes, reported once an hour so runs on the emulator or a watch can be
+ * compared over a simulated or real day.
+ */
+#include <pebble.h>
+#include "perf.h"
+
+#if PERF_COUNTERS
+
+static uint32_t s_counts[PERF_COUNTER_COUNT];
+
+void perf_count(PerfCounter counter)
+{
+  s_counts[counter]++;
+}
+
+#endif
+
+#if PERF_PROFILE
+
+// Buckets are <1, <2, <4 ... <64 and >=64 milliseconds
+#define PERF_BUCKETS 8
+
+static const char *s_section_names[PERF_SECTION_COUNT] = {
+  "bluetooth", "hour", "minute", "steps", "info", "watch", "health"
+};
+static uint16_t s_histograms[PERF_SECTION_COUNT][PERF_BUCKETS];
+static uint16_t s_worst[PERF_SECTION_COUNT];
+
+uint32_t perf_time_start(void)
+{
+  time_t seconds;
+  uint16_t ms;
+  time_ms(&seconds, &ms);
+  return (uint32_t)seconds * 1000 + ms;
+}
+
+/**
+ * Add the time since start to the histogram of a section
+ *
+ * @param section The section that was timed
+ * @param start   The result of perf_time_start when the section began
+ */
+void perf_time_end(PerfSection section, uint32_t start)
+{
+  uint32_t elapsed = perf_time_start() - start;
+  int bucket = 0;
+  while (bucket < PERF_BUCKETS - 1 && elapsed >= (1u << bucket)) bucket++;
+  if (s_histograms[section][bucket] < UINT16_MAX) s_histograms[section][bucket]++;
+  if (elapsed > s_worst[section]) s_worst[section] = elapsed > UINT16_MAX ? UINT16_MAX : elapsed;
+}
+
+#endif
+
+#if PERF_HEAP
+
+#define PERF_HEAP_ENTRIES 24
+
+typedef struct {
+  const char *resource;
+  int32_t bytes;
+} HeapEntry;
+
+static HeapEntry s_heap_entries[PERF_HEAP_ENTRIES];
+static int s_heap_entry_count;
+static size_t s_heap_last_used, s_heap_window_base;
+static bool s_heap_loading, s_heap_window_loaded;
+
+/**
+ * Start recording the heap taken or given back by each resource
+ *
+ * @param loading Whether the window is loading, otherwise unloading
+ */
+void perf_heap_begin(bool loading)
+{
+  s_heap_loading = loading;
+  s_heap_entry_count = 0;
+  s_heap_last_used = heap_bytes_used();
+  if (loading) {
+    s_heap_window_base = s_heap_last_used;
+    s_heap_window_loaded = true;
+  }
+}
+
+/**
+ * Record the change in heap use since the last mark
+ *
+ * @param resource The resource created or destroyed since the last mark
+ */
+void perf_heap_mark(const char *resource)
+{
+  size_t used = heap_bytes_used();
+  if (s_heap_entry_count < PERF_HEAP_ENTRIES) {
+    s_heap_entries[s_heap_entry_count].resource = resource;
+    s_heap_entries[s_heap_entry_count].bytes = (int32_t)used - (int32_t)s_heap_last_used;
+    s_heap_entry_count++;
+  }
+  s_heap_last_used = used;
+}
+
+/**
+ * Log the recorded changes, and after an unload what the load/unload cycle
+ * did not give back
+ */
+void perf_heap_end(void)
+{
+  const char *phase = s_heap_loading ? "load" : "unload";
+  for (int i = 0; i < s_heap_entry_count; i++) {
+    APP_LOG(APP_LOG_LEVEL_INFO, "heap %s %s %d", phase, s_heap_entries[i].resource, (int)s_heap_entries[i].bytes);
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO, "heap %s used %d free %d", phase, (int)heap_bytes_used(), (int)heap_bytes_free());
+  if (!s_heap_loading && s_heap_window_loaded) {
+    APP_LOG(APP_LOG_LEVEL_INFO, "heap cycle kept %d", (int)heap_bytes_used() - (int)s_heap_window_base);
+  }
+}
+
+#endif
+
+#if PERF_COUNTERS || PERF_PROFILE
+
+/**
+ * Log what was gathered for the hour that just ended and start again
+ *
+ * @param hour The hour the numbers are for
+ */
+void perf_report(int hour)
+{
+#if PERF_COUNTERS
+  const uint32_t *c = s_counts;
+  APP_LOG(APP_LOG_LEVEL_INFO, "perf %02d: draws %d, health %d, messages %d, inbox %d tuples %d recomputes", hour,
+          (int)c[PERF_DRAW], (int)c[PERF_HEALTH_QUERY], (int)c[PERF_MESSAGE_SEND], (int)c[PERF_INBOX_TUPLE], (int)c[PERF_INBOX_RECOMPUTE]);
+  APP_LOG(APP_LOG_LEVEL_INFO, "perf %02d: marks background %d, hour %d, minute %d, steps %d, info %d, ring cache %d hits %d misses", hour,
+          (int)c[PERF_MARK_BACKGROUND], (int)c[PERF_MARK_HOUR], (int)c[PERF_MARK_MINUTE], (int)c[PERF_MARK_STEPS], (int)c[PERF_MARK_INFO],
+          (int)c[PERF_RING_CACHE_HIT], (int)c[PERF_RING_CACHE_MISS]);
+  memset(s_counts, 0, sizeof(s_counts));
+#endif
+#if PERF_PROFILE
+  for (int i = 0; i < PERF_SECTION_COUNT; i++) {
+    const uint16_t *h = s_histograms[i];
+    APP_LOG(APP_LOG_LEVEL_INFO, "perf %02d %s ms <1:%d <2:%d <4:%d <8:%d <16:%d <32:%d <64:%d more:%d worst %d", hour,
+            s_section_names[i], h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7], s_worst[i]);
+  }
+  memset(s_histograms, 0, sizeof(s_histograms));
+  memset(s_worst, 0, sizeof(s_worst));
+#endif
+}
+
+#endif
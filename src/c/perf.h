@@ -0,0 +1,83 @@
+#pragma once
+
+// Set to 1 to count the work done per hour and log it (pebble logs)
+#ifndef PERF_COUNTERS
+#define PERF_COUNTERS 0
+#endif
+// Set to 1 to time the update procs and log histograms of the timings each hour
+#ifndef PERF_PROFILE
+#define PERF_PROFILE 0
+#endif
+// Set to 1 to log the heap taken by each resource as the window loads and unloads
+#ifndef PERF_HEAP
+#define PERF_HEAP 0
+#endif
+
+typedef enum {
+  PERF_DRAW,            // Layer update procs run
+  PERF_MARK_BACKGROUND, // layer_mark_dirty calls from the render scheduler, per layer in REDRAW_* order
+  PERF_MARK_HOUR,
+  PERF_MARK_MINUTE,
+  PERF_MARK_STEPS,
+  PERF_MARK_INFO,
+  PERF_RING_CACHE_HIT,  // Frames whose rings came from the ring cache
+  PERF_RING_CACHE_MISS, // Frames that drew the rings
+  PERF_HEALTH_QUERY,    // Calls into the health service
+  PERF_MESSAGE_SEND,    // AppMessages sent to the phone
+  PERF_INBOX_TUPLE,     // Tuples received from the phone
+  PERF_INBOX_RECOMPUTE, // Recomputes run for them, fewer than the tuples when work was skipped
+  PERF_COUNTER_COUNT
+} PerfCounter;
+
+typedef enum {
+  PERF_BLUETOOTH_PROC,
+  PERF_HOUR_PROC,
+  PERF_MINUTE_PROC,
+  PERF_STEPS_PROC,
+  PERF_INFO_PROC,
+  PERF_UPDATE_WATCH,
+  PERF_UPDATE_HEALTH,
+  PERF_SECTION_COUNT
+} PerfSection;
+
+#if PERF_COUNTERS
+void perf_count(PerfCounter counter);
+#else
+#define perf_count(counter) ((void)0)
+#endif
+
+#if PERF_PROFILE
+uint32_t perf_time_start(void);
+void perf_time_end(PerfSection section, uint32_t start);
+
+// Wraps a layer update proc, register it with PERF_PROC(proc)
+#define PERF_PROFILED_PROC(proc, section) \
+  static void proc##_profiled(Layer *layer, GContext *ctx) \
+  { \
+    uint32_t start = perf_time_start(); \
+    proc(layer, ctx); \
+    perf_time_end(section, start); \
+  }
+#define PERF_PROC(proc) proc##_profiled
+#else
+#define perf_time_start() 0
+#define perf_time_end(section, start) ((void)(start))
+#define PERF_PROFILED_PROC(proc, section)
+#define PERF_PROC(proc) proc
+#endif
+
+#if PERF_HEAP
+void perf_heap_begin(bool loading);
+void perf_heap_mark(const char *resource);
+void perf_heap_end(void);
+#else
+#define perf_heap_begin(loading) ((void)0)
+#define perf_heap_mark(resource) ((void)0)
+#define perf_heap_end() ((void)0)
+#endif
+
+#if PERF_COUNTERS || PERF_PROFILE
+void perf_report(int hour);
+#else
+#define perf_report(hour) ((void)0)
+#endif
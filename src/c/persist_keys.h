@@ -0,0 +1,9 @@
+#pragma once
+
+// Keys used with persist_*, keep them unique across all modules
+enum {
+  PERSIST_KEY_SUN_TABLE_HEADER = 1,
+  PERSIST_KEY_SUN_TABLE_DATA = 2, // SUN_TABLE_CHUNKS keys from here
+  PERSIST_KEY_HEALTH_AVERAGES = 10,
+  PERSIST_KEY_STATE = 11,
+};
@@ -0,0 +1,107 @@
+/*
+ * Ring rasterizer working directly on the captured frame buffer, as an
+ * alternative to graphics_fill_radial. The ring geometry never changes, so
+ * the inner and outer edge of every row is worked out once and drawing is a
+ * span walk with an integer test against the end angle.
+ */
+#include <pebble.h>
+#include "utilities.h"
+#include "ring.h"
+
+// The spans write 8 bit pixels, only the colour platforms use them
+#if defined(PBL_COLOR)
+
+/**
+ * Work out the spans of a ring fitted as a circle in a frame, the same way
+ * GOvalScaleModeFitCircle places it
+ *
+ * @param ring      The spans to fill in
+ * @param frame     The frame of the ring in window coordinates
+ * @param thickness The thickness of the ring
+ * @return Whether the spans could be allocated
+ */
+bool ring_spans_create(RingSpans *ring, GRect frame, uint16_t thickness)
+{
+  int d = frame.size.w < frame.size.h ? frame.size.w : frame.size.h;
+  int r2 = d;                             // Outer radius in half pixels
+  int ri2 = (d >> 1) > thickness ? d - 2 * thickness : 0;
+
+  ring->top = frame.origin.y + ((frame.size.h - d) >> 1);
+  ring->rows = d;
+  ring->cx2 = 2 * frame.origin.x + frame.size.w - 1;
+  ring->cy2 = 2 * ring->top + d - 1;
+  ring->spans = malloc(4 * d);
+  if (!ring->spans) return false;
+
+  for (int i = 0; i < d; i++) {
+    uint8_t *span = &ring->spans[4 * i];
+    int dy2 = 2 * (ring->top + i) - ring->cy2;
+    int so = my_isqrt(r2 * r2 - dy2 * dy2);
+    span[0] = (ring->cx2 - so + 1) >> 1;
+    span[3] = (ring->cx2 + so) >> 1;
+
+    if (dy2 * dy2 < ri2 * ri2) {
+      int si = my_isqrt(ri2 * ri2 - dy2 * dy2 - 1);
+      span[1] = (ring->cx2 - si + 1) >> 1;
+      span[2] = (ring->cx2 + si) >> 1;
+    } else {
+      // No hole on this row, the left span covers it all
+      span[1] = span[3] + 1;
+      span[2] = span[3];
+    }
+  }
+  return true;
+}
+
+void ring_spans_destroy(RingSpans *ring)
+{
+  free(ring->spans);
+  ring->spans = NULL;
+}
+
+/**
+ * Fill the ring clockwise from 12 o'clock up to an angle
+ *
+ * @param fb        The captured frame buffer, 8 bit
+ * @param ring      The ring
+ * @param angle_end The end angle in TRIG_MAX_ANGLE units
+ * @param color     The colour to fill with
+ */
+void ring_fill(GBitmap *fb, const RingSpans *ring, int32_t angle_end, GColor color)
+{
+  if (angle_end <= 0 || !ring->spans) return;
+
+  bool full = angle_end >= TRIG_MAX_ANGLE;
+  bool wide = angle_end > TRIG_MAX_ANGLE / 2;
+  // Direction of the end angle in screen coordinates
+  int32_t ex = my_isin(angle_end);
+  int32_t ey = -my_icos(angle_end);
+
+  for (int i = 0; i < ring->rows; i++) {
+    const uint8_t *span = &ring->spans[4 * i];
+    int y = ring->top + i;
+    int dy2 = 2 * y - ring->cy2;
+    GBitmapDataRowInfo info = gbitmap_get_data_row_info(fb, y);
+
+    for (int part = 0; part < 2; part++) {
+      int x0 = part ? span[2] + 1 : span[0];
+      int x1 = part ? span[3] : (span[1] <= span[3] ? span[1] - 1 : span[3]);
+      if (x0 < info.min_x) x0 = info.min_x;
+      if (x1 > info.max_x) x1 = info.max_x;
+
+      for (int x = x0; x <= x1; x++) {
+        if (!full) {
+          int dx2 = 2 * x - ring->cx2;
+          // Right half is [0, 180) degrees from 12 o'clock
+          bool right = dx2 > 0 || (dx2 == 0 && dy2 < 0);
+          // Positive when the end angle is clockwise of the pixel by less than half a turn
+          bool before_end = (int32_t)dx2 * ey - (int32_t)dy2 * ex > 0;
+          if (wide ? !(right || before_end) : !(right && before_end)) continue;
+        }
+        info.data[x] = color.argb;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+
+// Per row spans of a ring, in absolute frame buffer coordinates
+typedef struct {
+  int16_t cx2, cy2; // Centre in half pixels
+  int16_t top, rows;
+  uint8_t *spans;   // Four per row: outer left, inner left, inner right, outer right
+} RingSpans;
+
+bool ring_spans_create(RingSpans *ring, GRect frame, uint16_t thickness);
+void ring_spans_destroy(RingSpans *ring);
+void ring_fill(GBitmap *fb, const RingSpans *ring, int32_t angle_end, GColor color);
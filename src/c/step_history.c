@@ -0,0 +1,227 @@
+/*
+ * Today's steps per minute, kept small enough to stay in RAM. Minutes are
+ * grouped in blocks with a running total at the start of each block, and the
+ * minutes inside a block are varint tokens: a count of steps, or a run of
+ * minutes without any. Appending is O(1) and a range sum decodes at most one
+ * block at each end.
+ */
+#include <pebble.h>
+#include "step_history.h"
+#include "perf.h"
+
+#if defined(PBL_HEALTH)
+
+#define MINUTES_PER_DAY 1440
+#define BLOCK_MINUTES 32
+#define BLOCKS (MINUTES_PER_DAY / BLOCK_MINUTES)
+#define POOL_SIZE 384
+#define HISTORY_CHUNK 60
+
+// Tokens are varint (count << 1) for steps, or ((minutes << 1) | 1) for a run without steps
+static uint8_t s_pool[POOL_SIZE];
+static uint16_t s_pool_used;
+static uint16_t s_block_offset[BLOCKS];
+static uint32_t s_block_start[BLOCKS + 1];   // Steps before each block, the last one is the total
+
+static int s_minutes;       // Minutes recorded today
+static int s_zero_run;      // Minutes without steps not written to the pool yet
+static int s_lost_block;    // First block whose minutes did not fit in the pool
+
+static void reset()
+{
+  s_pool_used = 0;
+  s_minutes = 0;
+  s_zero_run = 0;
+  s_lost_block = BLOCKS;
+  s_block_start[0] = 0;
+}
+
+static void write_token(uint32_t token)
+{
+  int block = (s_minutes - 1) / BLOCK_MINUTES;
+  uint8_t bytes[5];
+  int n = 0;
+
+  if (block >= s_lost_block) return;
+
+  do {
+    bytes[n++] = (token & 0x7f) | (token > 0x7f ? 0x80 : 0);
+    token >>= 7;
+  } while (token);
+
+  if (s_pool_used + n > POOL_SIZE) {
+    // Out of room, keep the block totals only from here on
+    s_lost_block = block;
+    return;
+  }
+  memcpy(&s_pool[s_pool_used], bytes, n);
+  s_pool_used += n;
+}
+
+static void flush_zero_run()
+{
+  if (s_zero_run == 0) return;
+  write_token((s_zero_run << 1) | 1);
+  s_zero_run = 0;
+}
+
+static void append(int steps)
+{
+  int block = s_minutes / BLOCK_MINUTES;
+
+  if (s_minutes % BLOCK_MINUTES == 0) {
+    // Runs never cross blocks, so a block decodes on its own
+    flush_zero_run();
+    s_block_offset[block] = s_pool_used;
+    s_block_start[block + 1] = s_block_start[block];
+  }
+
+  s_minutes++;
+  s_block_start[block + 1] += steps;
+
+  if (steps == 0) {
+    s_zero_run++;
+  } else {
+    flush_zero_run();
+    write_token((uint32_t)steps << 1);
+  }
+}
+
+/**
+ * Steps taken in the first minutes of a block
+ *
+ * @param block   The block
+ * @param minutes The number of minutes from the start of the block
+ */
+static int block_sum(int block, int minutes)
+{
+  int total = s_block_start[block + 1] - s_block_start[block];
+  int recorded = s_minutes - block * BLOCK_MINUTES;
+  if (recorded > BLOCK_MINUTES) recorded = BLOCK_MINUTES;
+
+  if (minutes >= recorded) return total;
+
+  if (block >= s_lost_block) {
+    // No per minute data, spread the block evenly
+    return total * minutes / recorded;
+  }
+
+  const uint8_t *p = &s_pool[s_block_offset[block]];
+  const uint8_t *end = &s_pool[s_pool_used];
+  int sum = 0, minute = 0;
+  // The current block may end in a run that is not written yet
+  while (minute < minutes && p < end) {
+    uint32_t token = 0;
+    int shift = 0;
+    do {
+      token |= (uint32_t)(*p & 0x7f) << shift;
+      shift += 7;
+    } while (*p++ & 0x80);
+
+    if (token & 1) {
+      minute += token >> 1;
+    } else {
+      sum += token >> 1;
+      minute++;
+    }
+  }
+  return sum;
+}
+
+static int steps_before(int minute)
+{
+  if (minute <= 0) return 0;
+  if (minute >= s_minutes) return s_block_start[(s_minutes - 1) / BLOCK_MINUTES + 1];
+
+  int block = minute / BLOCK_MINUTES;
+  return s_block_start[block] + block_sum(block, minute % BLOCK_MINUTES);
+}
+
+/**
+ * Record today's step total at a minute, the minutes since the last update
+ * get the difference
+ *
+ * @param minute      Minutes since midnight
+ * @param steps_today The steps taken today so far
+ */
+void step_history_update(int minute, int steps_today)
+{
+  if (minute < 0 || minute >= MINUTES_PER_DAY) return;
+  if (minute < s_minutes - 1) reset();
+
+  int steps = steps_today - step_history_total();
+  if (steps < 0) steps = 0;
+
+  while (s_minutes < minute) append(0);
+  if (s_minutes == minute) append(steps);
+}
+
+/**
+ * Fill in today from the health service minute history
+ */
+void step_history_init()
+{
+  reset();
+
+  HealthMinuteData *data = malloc(HISTORY_CHUNK * sizeof(HealthMinuteData));
+  if (!data) return;
+
+  time_t today = time_start_of_today();
+  time_t end = time(NULL);
+  time_t start = today;
+
+  while (start < end) {
+    time_t from = start, to = end;
+    perf_count(PERF_HEALTH_QUERY);
+    uint32_t n = health_service_get_minute_history(data, HISTORY_CHUNK, &from, &to);
+    if (n == 0) break;
+
+    int minute = (from - today) / SECONDS_PER_MINUTE;
+    while (s_minutes < minute) append(0);
+    for (uint32_t i = 0; i < n && s_minutes < MINUTES_PER_DAY; i++) {
+      append(data[i].is_invalid ? 0 : data[i].steps);
+    }
+    start = from + n * SECONDS_PER_MINUTE;
+  }
+
+  free(data);
+}
+
+/**
+ * Steps taken in a range of minutes
+ *
+ * @param from The first minute since midnight
+ * @param to   The minute after the last one
+ */
+int step_history_sum(int from, int to)
+{
+  return steps_before(to) - steps_before(from);
+}
+
+int step_history_total()
+{
+  return s_minutes ? (int)s_block_start[(s_minutes - 1) / BLOCK_MINUTES + 1] : 0;
+}
+
+#else
+
+// No health service on this platform, nothing to record
+void step_history_update(int minute, int steps_today)
+{
+}
+
+void step_history_init()
+{
+}
+
+int step_history_sum(int from, int to)
+{
+  return 0;
+}
+
+int step_history_total()
+{
+  return 0;
+}
+
+#endif
@@ -0,0 +1,6 @@
+#pragma once
+
+void step_history_init();
+void step_history_update(int minute, int steps_today);
+int step_history_sum(int from, int to);
+int step_history_total();
@@ -0,0 +1,177 @@
+/*
+ * Sunrise/sunset minutes (UTC) for every day of the year at the current
+ * location. The table is filled a few days per event loop turn when the
+ * location changes and kept in persistent storage, so the per-day path is a
+ * plain lookup.
+ */
+#include <pebble.h>
+#include "utilities.h"
+#include "persist_keys.h"
+#include "sun_table.h"
+
+// Two 12 bit minute values packed into 3 bytes
+#define SUN_TABLE_ENTRY_SIZE 3
+#define SUN_TABLE_ENTRIES_PER_CHUNK (PERSIST_DATA_MAX_LENGTH / SUN_TABLE_ENTRY_SIZE)
+#define SUN_TABLE_CHUNKS ((SUN_TABLE_DAYS + SUN_TABLE_ENTRIES_PER_CHUNK - 1) / SUN_TABLE_ENTRIES_PER_CHUNK)
+
+#define SUN_TABLE_DAYS_PER_STEP 16
+#define SUN_TABLE_STEP_DELAY 50
+
+// Moves smaller than this (~0.1 degrees) keep the current table
+#define SUN_TABLE_TOLERANCE 18
+
+// Bumped when the stored entries change meaning
+#define SUN_TABLE_VERSION 3
+
+// Entry values for days the sun does not rise or set, out of the 0-1439 range
+#define SUN_TABLE_POLAR_DAY 0xfff
+#define SUN_TABLE_POLAR_NIGHT 0xffe
+
+typedef struct {
+  int32_t version;
+  int32_t latitude;
+  int32_t longitude;
+} SunTableHeader;
+
+static uint8_t s_table[SUN_TABLE_DAYS * SUN_TABLE_ENTRY_SIZE];
+static SunTableHeader s_header;
+static SunTableReadyHandler s_ready_handler;
+
+static AppTimer *s_build_timer;
+static int s_build_start, s_build_count;
+static bool s_ready = false;
+
+static void set_entry(int yday, int sunrise, int sunset)
+{
+  uint8_t *e = &s_table[yday * SUN_TABLE_ENTRY_SIZE];
+  e[0] = sunrise & 0xff;
+  e[1] = ((sunrise >> 8) & 0x0f) | ((sunset & 0x0f) << 4);
+  e[2] = sunset >> 4;
+}
+
+static void save_table()
+{
+  for (int i = 0; i < SUN_TABLE_CHUNKS; i++) {
+    int offset = i * SUN_TABLE_ENTRIES_PER_CHUNK * SUN_TABLE_ENTRY_SIZE;
+    int size = sizeof(s_table) - offset;
+    if (size > SUN_TABLE_ENTRIES_PER_CHUNK * SUN_TABLE_ENTRY_SIZE) size = SUN_TABLE_ENTRIES_PER_CHUNK * SUN_TABLE_ENTRY_SIZE;
+    persist_write_data(PERSIST_KEY_SUN_TABLE_DATA + i, s_table + offset, size);
+  }
+  // The header goes last, it marks the data as complete
+  persist_write_data(PERSIST_KEY_SUN_TABLE_HEADER, &s_header, sizeof(s_header));
+}
+
+static bool load_table()
+{
+  if (persist_read_data(PERSIST_KEY_SUN_TABLE_HEADER, &s_header, sizeof(s_header)) != sizeof(s_header) || s_header.version != SUN_TABLE_VERSION)
+    return false;
+
+  for (int i = 0; i < SUN_TABLE_CHUNKS; i++) {
+    int offset = i * SUN_TABLE_ENTRIES_PER_CHUNK * SUN_TABLE_ENTRY_SIZE;
+    int size = sizeof(s_table) - offset;
+    if (size > SUN_TABLE_ENTRIES_PER_CHUNK * SUN_TABLE_ENTRY_SIZE) size = SUN_TABLE_ENTRIES_PER_CHUNK * SUN_TABLE_ENTRY_SIZE;
+    if (persist_read_data(PERSIST_KEY_SUN_TABLE_DATA + i, s_table + offset, size) != size)
+      return false;
+  }
+  return true;
+}
+
+static void build_step(void *data)
+{
+  s_build_timer = NULL;
+
+  for (int i = 0; i < SUN_TABLE_DAYS_PER_STEP && s_build_count < SUN_TABLE_DAYS; i++, s_build_count++) {
+    int yday = (s_build_start + s_build_count) % SUN_TABLE_DAYS;
+    SunEvents events;
+    calcSunDayEventsFixed(yday + 1, s_header.latitude, s_header.longitude, ZENITH_OFFICIAL_ANGLE, &events);
+    switch (events.kind) {
+      case SUN_EVENTS_POLAR_DAY:
+        set_entry(yday, SUN_TABLE_POLAR_DAY, SUN_TABLE_POLAR_DAY);
+        break;
+      case SUN_EVENTS_POLAR_NIGHT:
+        set_entry(yday, SUN_TABLE_POLAR_NIGHT, SUN_TABLE_POLAR_NIGHT);
+        break;
+      default:
+        set_entry(yday, events.rise, events.set);
+    }
+  }
+
+  if (s_build_count < SUN_TABLE_DAYS) {
+    s_build_timer = app_timer_register(SUN_TABLE_STEP_DELAY, build_step, NULL);
+    return;
+  }
+
+  s_ready = true;
+  save_table();
+  if (s_ready_handler) s_ready_handler();
+}
+
+void sun_table_init(SunTableReadyHandler handler)
+{
+  s_ready_handler = handler;
+  s_ready = load_table();
+}
+
+void sun_table_deinit()
+{
+  if (s_build_timer) app_timer_cancel(s_build_timer);
+  s_build_timer = NULL;
+}
+
+/**
+ * Rebuild the table for a new location, angles are in TRIG_MAX_ANGLE units
+ *
+ * @param latitude  The latitude
+ * @param longitude The longitude
+ */
+void sun_table_update(int32_t latitude, int32_t longitude)
+{
+  if (s_ready || s_build_timer) {
+    int32_t dlat = latitude - s_header.latitude;
+    int32_t dlon = longitude - s_header.longitude;
+    if (dlat <= SUN_TABLE_TOLERANCE && dlat >= -SUN_TABLE_TOLERANCE && dlon <= SUN_TABLE_TOLERANCE && dlon >= -SUN_TABLE_TOLERANCE)
+      return;
+  }
+
+  s_header.version = SUN_TABLE_VERSION;
+  s_header.latitude = latitude;
+  s_header.longitude = longitude;
+  s_ready = false;
+
+  // Start with today so it is available after the first step
+  time_t temp = time(NULL);
+  s_build_start = localtime(&temp)->tm_yday;
+  s_build_count = 0;
+
+  if (s_build_timer) app_timer_cancel(s_build_timer);
+  build_step(NULL);
+}
+
+/**
+ * Get the sunrise and sunset of a day in minutes UTC (0-1439), or whether
+ * the sun stays up or down all day
+ *
+ * @param yday   The day of the year (tm_yday)
+ * @param events Set to the events of the day
+ * @return Whether the day is available yet
+ */
+bool sun_table_lookup(int yday, SunEvents *events)
+{
+  if (!s_ready && (s_build_timer == NULL || (yday - s_build_start + SUN_TABLE_DAYS) % SUN_TABLE_DAYS >= s_build_count))
+    return false;
+
+  const uint8_t *e = &s_table[yday * SUN_TABLE_ENTRY_SIZE];
+  int sunrise = e[0] | ((e[1] & 0x0f) << 8);
+  int sunset = (e[1] >> 4) | (e[2] << 4);
+
+  if (sunrise == SUN_TABLE_POLAR_DAY) {
+    events->kind = SUN_EVENTS_POLAR_DAY;
+  } else if (sunrise == SUN_TABLE_POLAR_NIGHT) {
+    events->kind = SUN_EVENTS_POLAR_NIGHT;
+  } else {
+    events->kind = SUN_EVENTS_RISE_SET;
+    events->rise = sunrise;
+    events->set = sunset;
+  }
+  return true;
+}
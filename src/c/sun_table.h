@@ -0,0 +1,11 @@
+#pragma once
+
+// One entry per day of the year, tm_yday indexes it directly
+#define SUN_TABLE_DAYS 366
+
+typedef void (*SunTableReadyHandler)(void);
+
+void sun_table_init(SunTableReadyHandler handler);
+void sun_table_deinit();
+void sun_table_update(int32_t latitude, int32_t longitude);
+bool sun_table_lookup(int yday, SunEvents *events);
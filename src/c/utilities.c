@@ -6,8 +6,22 @@
 #include <pebble.h>
 #include "utilities.h"
 
+#if HOST_SOLVERS
+/*
+ * The float helpers come in three precision tiers (MATH_FAST, MATH_BALANCED,
+ * MATH_ACCURATE, see utilities.h). The *_tier functions take the tier as a
+ * constant, so each call site only keeps the branch it asked for. Errors
+ * below are the max measured in float against libm in double. Cost in ns per
+ * call on an x86-64 host at -O2, fast / balanced / accurate (relative only,
+ * the watch has no FPU):
+ *   sqrt  4.0 /  4.0 /  3.6   sin   9.9 / 10.7 / 14.7
+ *   atan  3.8 /  7.5 / 10.5   acos  7.7 / 10.0 / 18.3
+ * bench/tiers_bench.c measures all of these, `make -C bench tiers`.
+ */
+
 #define SQRT_MAGIC_F 0x5f3759df 
-float my_sqrt(const float x)
+/* rel. err. fast 1.8e-3 (one Newton step), balanced 4.8e-6 (two), accurate 1.8e-7 (three) */
+static inline float sqrt_tier(const float x, int tier)
 {
   const float xhalf = 0.5f*x;
  
@@ -18,9 +32,17 @@ float my_sqrt(const float x)
   } u;
   u.x = x;
   u.i = SQRT_MAGIC_F - (u.i >> 1);  // gives initial guess y0
-  return x*u.x*(1.5f - xhalf*u.x*u.x);// Newton step, repeating increases accuracy 
+  u.x = u.x*(1.5f - xhalf*u.x*u.x); // Newton step, repeating increases accuracy
+  if (tier >= MATH_BALANCED) u.x = u.x*(1.5f - xhalf*u.x*u.x);
+  if (tier >= MATH_ACCURATE) u.x = u.x*(1.5f - xhalf*u.x*u.x);
+  return x*u.x;
 }   
 
+float my_sqrt(const float x)
+{
+  return sqrt_tier(x, MATH_PRECISION);
+}
+
 float my_floor(float x) 
 {
   return ((int)x);
@@ -32,16 +54,38 @@ float my_fabs(float x)
   return x;
 }
 
-float my_atan(float x)
+/* near minimax fits to atan on [0, 1]: balanced degree 11 (abs. err. 2.4e-6),
+ * accurate degree 15 (1.1e-7); atan_tier does not call it for MATH_FAST */
+static inline float atan_core(float x, int tier)
 {
-  if (x>0) 
-  {
-    return (M_PI/2)*(0.596227*x + x*x)/(1 + 2*0.596227*x + x*x);
-  } 
-  else
-  {
-    return -(my_atan(-x));
+  float x2 = x * x;
+  if (tier == MATH_BALANCED) {
+    return ((((-1.2808401048e-2f * x2 + 5.5806228102e-2f) * x2 - 1.1981894197e-1f) * x2 +
+             1.9518289367e-1f) * x2 - 3.3296597308e-1f) * x2 * x + x;
   }
+  return ((((((-4.3554737355e-3f * x2 + 2.3040385033e-2f) * x2 - 5.7773951766e-2f) * x2 +
+              9.7942609386e-2f) * x2 - 1.3976592120e-1f) * x2 + 1.9962705803e-1f) * x2 -
+          3.3331659153e-1f) * x2 * x + x;
+}
+
+/* abs. err. fast 2.8e-3 rad (~0.16 deg), balanced 2.4e-6, accurate 1.2e-7 */
+static inline float atan_tier(float x, int tier)
+{
+  float xa = my_fabs(x), t;
+  if (tier == MATH_FAST) {
+    t = (M_PI/2)*(0.596227f*xa + xa*xa)/(1 + 2*0.596227f*xa + xa*xa);
+  } else if (xa > 1) {
+    /* atan(x) = pi/2 - atan(1/x) */
+    t = (M_PI/2) - atan_core(1 / xa, tier);
+  } else {
+    t = atan_core(xa, tier);
+  }
+  return (x < 0) ? -t : t;
+}
+
+float my_atan(float x)
+{
+  return atan_tier(x, MATH_PRECISION);
 }
 
 /* not quite rint(), i.e. results not properly rounded to nearest-or-even */
@@ -51,11 +95,19 @@ float my_rint (float x)
   return (x < 0.0) ? -t : t;
 }
 
-/* minimax approximation to cos on [-pi/4, pi/4] with rel. err. ~= 7.5e-13 */
-float cos_core (float x)
+/* approximations to cos on [-pi/4, pi/4], near minimax fits of degree 4, 6
+ * and 8: abs. err. fast 1.2e-5, balanced 9.7e-8, accurate 4.4e-8 (float
+ * rounding) */
+static inline float cos_core (float x, int tier)
 {
   float x8, x4, x2;
   x2 = x * x;
+  if (tier == MATH_FAST) {
+    return (4.0488935879e-2f * x2 - 4.9977630709e-1f) * x2 + 1.0f;
+  }
+  if (tier == MATH_BALANCED) {
+    return ((-1.3597823134e-3f * x2 + 4.1656294580e-2f) * x2 - 4.9999894781e-1f) * x2 + 1.0f;
+  }
   x4 = x2 * x2;
   x8 = x4 * x4;
   /* evaluate polynomial using Estrin's scheme */
@@ -64,22 +116,39 @@ float cos_core (float x)
          (-4.9999999999963024e-1 * x2 + 1.0000000000000000e+0);
 }
 
-/* minimax approximation to sin on [-pi/4, pi/4] with rel. err. ~= 5.5e-12 */
-float sin_core (float x)
+/* approximations to sin on [-pi/4, pi/4], near minimax fits of degree 5, 7
+ * and 9: rel. err. fast 1.9e-6, balanced 7.2e-8, accurate 6.2e-8 (float
+ * rounding) */
+static inline float sin_core (float x, int tier)
 {
   float x4, x2;
   x2 = x * x;
+  if (tier == MATH_FAST) {
+    return (8.1632819257e-3f * x2 - 1.6663390378e-1f) * x2 * x + x;
+  }
+  if (tier == MATH_BALANCED) {
+    return ((-1.9515283219e-4f * x2 + 8.3321607621e-3f) * x2 - 1.6666654610e-1f) * x2 * x + x;
+  }
   x4 = x2 * x2;
   /* evaluate polynomial using a mix of Estrin's and Horner's scheme */
   return ((2.7181216275479732e-6 * x2 - 1.9839312269456257e-4) * x4 + 
           (8.3333293048425631e-3 * x2 - 1.6666666640797048e-1)) * x2 * x + x;
 }
 
-/* minimax approximation to arcsin on [0, 0.5625] with rel. err. ~= 1.5e-11 */
-float asin_core (float x)
+/* approximations to arcsin on [0, 0.5625], near minimax fits of degree 7, 11
+ * and 17: rel. err. fast 5.2e-6, balanced 8.9e-8, accurate 6.1e-8 (float
+ * rounding) */
+static inline float asin_core (float x, int tier)
 {
   float x8, x4, x2;
   x2 = x * x;
+  if (tier == MATH_FAST) {
+    return ((7.1605315796e-2f * x2 + 6.9413001458e-2f) * x2 + 1.6697847991e-1f) * x2 * x + x;
+  }
+  if (tier == MATH_BALANCED) {
+    return ((((5.1198327877e-2f * x2 + 1.8515401565e-2f) * x2 + 4.6686499788e-2f) * x2 +
+             7.4851078349e-2f) * x2 + 1.6667014137e-1f) * x2 * x + x;
+  }
   x4 = x2 * x2;
   x8 = x4 * x4;
   /* evaluate polynomial using a mix of Estrin's and Horner's scheme */
@@ -89,8 +158,9 @@ float asin_core (float x)
           (7.5000364034134126e-2 * x2 + 1.6666666300567365e-1)) * x2 * x + x; 
 }
 
-/* relative error < 7e-12 on [-50000, 50000] */
-float my_sin (float x)
+/* abs. err. on [-50, 50] fast 1.2e-5, balanced 1.1e-7, accurate 6.1e-8 (the
+ * reduction loses accuracy for larger x) */
+static inline float sin_tier (float x, int tier)
 {
   float q, t;
   int quadrant;
@@ -100,20 +170,31 @@ float my_sin (float x)
   t = x - q * 1.5707963267923333e+00;
   t = t - q * 2.5633441515945189e-12;
   if (quadrant & 1) {
-    t = cos_core(t);
+    t = cos_core(t, tier);
   } else {
-    t = sin_core(t);
+    t = sin_core(t, tier);
   }
   return (quadrant & 2) ? -t : t;
 }
 
+float my_sin (float x)
+{
+  return sin_tier(x, MATH_PRECISION);
+}
+
+static inline float cos_tier(float x, int tier)
+{
+  return sin_tier(x + (M_PI/2), tier);
+}
+
 float my_cos(float x)
 {
-  return my_sin(x + (M_PI/2));
+  return cos_tier(x, MATH_PRECISION);
 }
 
-/* relative error < 2e-11 on [-1, 1] */
-float my_acos (float x)
+/* abs. err. on [-1, 1] fast 1.5e-3, balanced 4.3e-6, accurate 2.8e-7, dominated
+ * by the square root near |x| = 1 */
+static inline float acos_tier (float x, int tier)
 {
   float xa, t;
   xa = my_fabs (x);
@@ -122,24 +203,42 @@ float my_acos (float x)
    * arccos(x) = 2 * arcsin (sqrt ((1-x) / 2))
    */
   if (xa > 0.5625) {
-    t = 2.0 * asin_core (my_sqrt (0.5 * (1.0 - xa)));
+    t = 2.0 * asin_core (sqrt_tier (0.5 * (1.0 - xa), tier), tier);
   } else {
-    t = 1.5707963267948966 - asin_core (xa);
+    t = 1.5707963267948966 - asin_core (xa, tier);
   }
   /* arccos (-x) = pi - arccos(x) */
   return (x < 0.0) ? (3.1415926535897932 - t) : t;
 }
 
+float my_acos (float x)
+{
+  return acos_tier(x, MATH_PRECISION);
+}
+
+static inline float asin_tier (float x, int tier)
+{
+  return (M_PI/2) - acos_tier(x, tier);
+}
+
 float my_asin (float x)
 {
-  return (M_PI/2) - my_acos(x);
+  return asin_tier(x, MATH_PRECISION);
+}
+
+static inline float tan_tier(float x, int tier)
+{
+  return sin_tier(x, tier) / cos_tier(x, tier);
 }
 
 float my_tan(float x)
 {
-  return my_sin(x) / my_cos(x);
+  return tan_tier(x, MATH_PRECISION);
 }
 
+/* against the same algorithm in double precision for |latitude| <= 65, official
+ * and civil zenith: max 1.2 min with MATH_FAST, 0.011 min with MATH_BALANCED,
+ * 0.010 min with MATH_ACCURATE (MATH_FAST is off by the atan approximation) */
 float calcSun(int year, int month, int day, float latitude, float longitude, int sunset, float zenith)
 {
   int N1 = my_floor(275 * month / 9);
@@ -165,13 +264,13 @@ float calcSun(int year, int month, int day, float latitude, float longitude, int
 
   //calculate the Sun's true longitude
   //L = M + (1.916 * sin(M)) + (0.020 * sin(2 * M)) + 282.634
-  float L = M + (1.916 * my_sin((M_PI/180.0f) * M)) + (0.020 * my_sin((M_PI/180.0f) * 2 * M)) + 282.634;
+  float L = M + (1.916 * sin_tier((M_PI/180.0f) * M, SUN_PRECISION)) + (0.020 * sin_tier((M_PI/180.0f) * 2 * M, SUN_PRECISION)) + 282.634;
   if (L<0) L+=360.0f;
   if (L>360) L-=360.0f;
 
   //5a. calculate the Sun's right ascension
   //RA = atan(0.91764 * tan(L))
-  float RA = (180.0f/M_PI) * my_atan(0.91764 * my_tan((M_PI/180.0f) * L));
+  float RA = (180.0f/M_PI) * atan_tier(0.91764 * tan_tier((M_PI/180.0f) * L, SUN_PRECISION), SUN_PRECISION);
   if (RA<0) RA+=360;
   if (RA>360) RA-=360;
 
@@ -184,12 +283,12 @@ float calcSun(int year, int month, int day, float latitude, float longitude, int
   RA = RA / 15;
 
   //6. calculate the Sun's declination
-  float sinDec = 0.39782 * my_sin((M_PI/180.0f) * L);
-  float cosDec = my_cos(my_asin(sinDec));
+  float sinDec = 0.39782 * sin_tier((M_PI/180.0f) * L, SUN_PRECISION);
+  float cosDec = cos_tier(asin_tier(sinDec, SUN_PRECISION), SUN_PRECISION);
 
   //7a. calculate the Sun's local hour angle
   //cosH = (cos(zenith) - (sinDec * sin(latitude))) / (cosDec * cos(latitude))
-  float cosH = (my_cos((M_PI/180.0f) * zenith) - (sinDec * my_sin((M_PI/180.0f) * latitude))) / (cosDec * my_cos((M_PI/180.0f) * latitude));
+  float cosH = (cos_tier((M_PI/180.0f) * zenith, SUN_PRECISION) - (sinDec * sin_tier((M_PI/180.0f) * latitude, SUN_PRECISION))) / (cosDec * cos_tier((M_PI/180.0f) * latitude, SUN_PRECISION));
   
   if (cosH >  1) {
     return 0;
@@ -205,12 +304,12 @@ float calcSun(int year, int month, int day, float latitude, float longitude, int
   if (!sunset)
   {
     //if rising time is desired:
-    H = 360 - (180.0f/M_PI) * my_acos(cosH);
+    H = 360 - (180.0f/M_PI) * acos_tier(cosH, SUN_PRECISION);
   }
   else
   {
     //if setting time is desired:
-    H = (180.0f/M_PI) * my_acos(cosH);
+    H = (180.0f/M_PI) * acos_tier(cosH, SUN_PRECISION);
   }
   
   H = H / 15;
@@ -236,6 +335,412 @@ float calcSunSet(int year, int month, int day, float latitude, float longitude,
   return calcSun(year, month, day, latitude, longitude, 1, zenith);
 }
 
+/*
+ * Batch version of calcSun. The lane helpers below are calcSun's steps with
+ * the branches turned into selects between values that are always computed
+ * (compilers will not speculate float operations that may trap), so the loop
+ * in calcSunBatch has no calls or control flow left and GCC/Clang vectorize
+ * it at -O3. On the watch it is simply a loop. bench/batch_bench.c measures
+ * it on the host: 0.65 min worst against calcSun in double precision, and
+ * about 5, 25 and 90 M events/s at -O2, -O3 and -O3 -march=native against
+ * 4-5 M for calcSun.
+ */
+/* cond ? a : b on the bits, so both sides stay computed */
+static inline float lane_select(bool cond, float a, float b)
+{
+  union {
+    float f;
+    int32_t i;
+  } ua = { .f = a }, ub = { .f = b }, r;
+  int32_t mask = -(int32_t)cond;
+  r.i = (ua.i & mask) | (ub.i & ~mask);
+  return r.f;
+}
+
+static inline float lane_floor(float x)
+{
+  int i = (int)x;
+  return (float)(i - (x < (float)i));
+}
+
+static inline float lane_sin(float x)
+{
+  float q = lane_floor(x * 6.3661977e-1f + 0.5f);
+  int quadrant = (int)q;
+  float t = x - q * 1.5707963f;
+  float t2 = t * t;
+  float s = ((2.7181216e-6f * t2 - 1.9839312e-4f) * t2 * t2 + (8.3333293e-3f * t2 - 1.6666667e-1f)) * t2 * t + t;
+  float c = ((-2.7236370e-7f * t2 + 2.4799853e-5f) * t2 - 1.3888885e-3f) * t2 * t2 * t2 + (4.1666667e-2f * t2 - 0.5f) * t2 + 1.0f;
+  float r = lane_select(quadrant & 1, c, s);
+  return lane_select(quadrant & 2, -r, r);
+}
+
+static inline float lane_sqrt(float x)
+{
+  union {
+    float f;
+    int i;
+  } u = { .f = x };
+  u.i = SQRT_MAGIC_F - (u.i >> 1);
+  float y = u.f * (1.5f - 0.5f * x * u.f * u.f);
+  y = y * (1.5f - 0.5f * x * y * y);
+  return x * y;
+}
+
+static inline float lane_atan(float x)
+{
+  float a = my_fabs(x);
+  float r = (float)(M_PI / 2) * (0.596227f * a + a * a) / (1.0f + 2.0f * 0.596227f * a + a * a);
+  return lane_select(x < 0.0f, -r, r);
+}
+
+static inline float lane_acos(float x)
+{
+  float xa = my_fabs(x);
+  bool big = xa > 0.5625f;
+  float root = lane_sqrt(0.5f * (1.0f - xa));
+  float a = lane_select(big, root, xa);
+  float a2 = a * a;
+  float a4 = a2 * a2;
+  float p = (((4.5334221e-2f * a2 - 1.1226217e-2f) * a4 + (2.6334281e-2f * a2 + 2.0596336e-2f)) * a4 * a4 +
+             (3.0582044e-2f * a2 + 4.4630539e-2f) * a4 + (7.5000364e-2f * a2 + 1.6666666e-1f)) * a2 * a + a;
+  float twice = 2.0f * p, rest = 1.5707963f - p;
+  float t = lane_select(big, twice, rest);
+  float other = 3.1415927f - t;
+  return lane_select(x < 0.0f, other, t);
+}
+
+/* calcSun for one event, hour is 6 for the sunrise and 18 for the sunset */
+static inline float sun_lane(float N, float lngHour, float sinLat, float cosLat, float cosZenith, float hour)
+{
+  const float rad = (float)(M_PI / 180.0), deg = (float)(180.0 / M_PI);
+
+  float t = N + (hour - lngHour) / 24.0f;
+  float M = 0.9856f * t - 3.289f;
+  float L = M + 1.916f * lane_sin(rad * M) + 0.020f * lane_sin(rad * 2.0f * M) + 282.634f;
+  L = lane_select(L < 0.0f, L + 360.0f, L);
+  L = lane_select(L > 360.0f, L - 360.0f, L);
+
+  float sinL = lane_sin(rad * L);
+  float cosL = lane_sin(rad * L + (float)(M_PI / 2));
+  float RA = deg * lane_atan(0.91764f * sinL / cosL);
+  RA = lane_select(RA < 0.0f, RA + 360.0f, RA);
+  RA = lane_select(RA > 360.0f, RA - 360.0f, RA);
+  RA = (RA + (lane_floor(L / 90.0f) - lane_floor(RA / 90.0f)) * 90.0f) / 15.0f;
+
+  float sinDec = 0.39782f * sinL;
+  float cosDec = lane_sqrt(1.0f - sinDec * sinDec);
+
+  float cosH = (cosZenith - sinDec * sinLat) / (cosDec * cosLat);
+  bool polar = (cosH > 1.0f) | (cosH < -1.0f);
+  cosH = lane_select(cosH > 1.0f, 1.0f, lane_select(cosH < -1.0f, -1.0f, cosH));
+
+  float H = deg * lane_acos(cosH);
+  float rising = 360.0f - H;
+  H = lane_select(hour < 12.0f, rising, H) / 15.0f;
+
+  float UT = H + RA - 0.06571f * t - 6.622f - lngHour;
+  UT -= 24.0f * lane_floor(UT / 24.0f);
+  return lane_select(polar, 0.0f, UT);
+}
+
+/*
+ * calcSun for many places and days at once, structure of arrays in and out.
+ * Times are hours UTC, 0 when the sun does not rise or set (as calcSun).
+ * The year only matters to calcSun for turning a date into a day of the
+ * year, so days are given as the day of the year (1 based) here.
+ */
+void calcSunBatch(int count, const int *days, const float *latitudes, const float *longitudes, float zenith, float *rises, float *sets)
+{
+  const float rad = (float)(M_PI / 180.0);
+  float cosZenith = lane_sin(rad * zenith + (float)(M_PI / 2));
+
+  for (int i = 0; i < count; i++) {
+    float N = (float)days[i];
+    float lngHour = longitudes[i] / 15.0f;
+    float sinLat = lane_sin(rad * latitudes[i]);
+    float cosLat = lane_sin(rad * latitudes[i] + (float)(M_PI / 2));
+    rises[i] = sun_lane(N, lngHour, sinLat, cosLat, cosZenith, 6.0f);
+    sets[i] = sun_lane(N, lngHour, sinLat, cosLat, cosZenith, 18.0f);
+  }
+}
+#endif
+
+/* floor(sqrt(x)) using the bit-by-bit method, no float */
+uint32_t my_isqrt(uint32_t x)
+{
+  uint32_t res = 0;
+  uint32_t bit = 1u << 30;
+  while (bit > x) bit >>= 2;
+  while (bit) {
+    if (x >= res + bit) {
+      x -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return res;
+}
+
+/*
+ * Integer trigonometry over the SDK's angle domain: angles are in
+ * TRIG_MAX_ANGLE units and ratios in TRIG_MAX_RATIO fixed point, the same as
+ * sin_lookup/atan2_lookup, so results can be mixed with the SDK ones.
+ * Quarter wave tables with linear interpolation between 64 segments:
+ *  - my_isin/my_icos: abs. err. <= 7 / TRIG_MAX_RATIO (~1e-4)
+ *  - my_iatan2/my_iasin/my_iacos: abs. err. <= 3 TRIG_MAX_ANGLE units (~0.016 deg),
+ *    for asin/acos only while |x| < 0.999, the slope grows without bound at 1
+ *  - my_itan: abs. err. ~1e-4 / cos^2, saturates at INT32_MAX
+ * bench/trig_bench.c measures these and the cost against the float kernels.
+ */
+#define TRIG_TABLE_BITS 6
+#define TRIG_QUARTER (TRIG_MAX_ANGLE / 4)
+#define TRIG_SEGMENT_BITS (14 - TRIG_TABLE_BITS)
+
+/* sin over a quarter turn in TRIG_MAX_RATIO units */
+static const uint16_t sin_table[(1 << TRIG_TABLE_BITS) + 1] = {
+  0, 1608, 3216, 4821, 6424, 8022, 9616, 11204, 12785, 14359, 15924, 17479,
+  19024, 20557, 22078, 23586, 25079, 26557, 28020, 29465, 30893, 32302, 33692,
+  35061, 36409, 37736, 39039, 40319, 41575, 42806, 44011, 45189, 46340, 47464,
+  48558, 49624, 50659, 51664, 52638, 53580, 54490, 55367, 56211, 57021, 57797,
+  58537, 59243, 59913, 60546, 61144, 61704, 62227, 62713, 63161, 63571, 63943,
+  64276, 64570, 64826, 65042, 65219, 65357, 65456, 65515, 65535
+};
+
+/* atan over [0, 1] in TRIG_MAX_ANGLE units */
+static const uint16_t atan_table[(1 << TRIG_TABLE_BITS) + 1] = {
+  0, 163, 326, 489, 651, 813, 975, 1136, 1297, 1457, 1617, 1775, 1933, 2090,
+  2246, 2401, 2555, 2708, 2860, 3010, 3159, 3307, 3453, 3599, 3742, 3884, 4025,
+  4164, 4302, 4438, 4572, 4705, 4836, 4966, 5094, 5220, 5344, 5467, 5589, 5708,
+  5826, 5943, 6058, 6171, 6282, 6392, 6500, 6607, 6712, 6815, 6917, 7018, 7117,
+  7214, 7310, 7405, 7498, 7589, 7679, 7768, 7856, 7942, 8026, 8110, 8192
+};
+
+/* sin of an angle within [0, TRIG_QUARTER] */
+static int32_t quarter_sin(int32_t a)
+{
+  int32_t i = a >> TRIG_SEGMENT_BITS;
+  int32_t f = a & ((1 << TRIG_SEGMENT_BITS) - 1);
+  if (i >= (1 << TRIG_TABLE_BITS)) return sin_table[1 << TRIG_TABLE_BITS];
+  return sin_table[i] + (((sin_table[i + 1] - sin_table[i]) * f) >> TRIG_SEGMENT_BITS);
+}
+
+int32_t my_isin(int32_t angle)
+{
+  int32_t a = angle & (TRIG_MAX_ANGLE - 1);
+  int32_t quadrant = a / TRIG_QUARTER;
+  a -= quadrant * TRIG_QUARTER;
+  if (quadrant & 1) a = TRIG_QUARTER - a;
+  int32_t v = quarter_sin(a);
+  return (quadrant & 2) ? -v : v;
+}
+
+int32_t my_icos(int32_t angle)
+{
+  return my_isin(angle + TRIG_QUARTER);
+}
+
+int32_t my_itan(int32_t angle)
+{
+  int32_t c = my_icos(angle);
+  int64_t t;
+  if (c == 0) return my_isin(angle) < 0 ? -INT32_MAX : INT32_MAX;
+  t = (int64_t)my_isin(angle) * TRIG_MAX_RATIO / c;
+  if (t > INT32_MAX) return INT32_MAX;
+  if (t < -INT32_MAX) return -INT32_MAX;
+  return t;
+}
+
+/* atan of n / d for 0 <= n <= d, d > 0 */
+static int32_t octant_atan(uint32_t n, uint32_t d)
+{
+  // Ratio with 8 fractional bits below the table index
+  uint32_t r = (uint32_t)(((uint64_t)n << (TRIG_TABLE_BITS + 8)) / d);
+  uint32_t i = r >> 8;
+  uint32_t f = r & 0xff;
+  if (i >= (1 << TRIG_TABLE_BITS)) return atan_table[1 << TRIG_TABLE_BITS];
+  return atan_table[i] + (((atan_table[i + 1] - atan_table[i]) * f) >> 8);
+}
+
+/* angle of (x, y) in [0, TRIG_MAX_ANGLE), like atan2_lookup but any size of argument */
+int32_t my_iatan2(int32_t y, int32_t x)
+{
+  uint32_t ax = x < 0 ? -(uint32_t)x : (uint32_t)x;
+  uint32_t ay = y < 0 ? -(uint32_t)y : (uint32_t)y;
+  int32_t a;
+
+  if (ax == 0 && ay == 0) return 0;
+  if (ay <= ax) {
+    a = octant_atan(ay, ax);
+  } else {
+    a = TRIG_QUARTER - octant_atan(ax, ay);
+  }
+
+  if (x < 0) a = TRIG_MAX_ANGLE / 2 - a;
+  if (y < 0) a = -a;
+  return a & (TRIG_MAX_ANGLE - 1);
+}
+
+/* sqrt(1 - x^2) of a TRIG_MAX_RATIO scaled value */
+static int32_t complement(int32_t x)
+{
+  uint32_t ax = x < 0 ? -x : x;
+  if (ax >= TRIG_MAX_RATIO) return 0;
+  return my_isqrt((uint32_t)TRIG_MAX_RATIO * TRIG_MAX_RATIO - ax * ax);
+}
+
+/* result in [-TRIG_MAX_ANGLE / 4, TRIG_MAX_ANGLE / 4] */
+int32_t my_iasin(int32_t x)
+{
+  int32_t a = my_iatan2(x, complement(x));
+  return a > TRIG_MAX_ANGLE / 2 ? a - TRIG_MAX_ANGLE : a;
+}
+
+/* result in [0, TRIG_MAX_ANGLE / 2] */
+int32_t my_iacos(int32_t x)
+{
+  return my_iatan2(complement(x), x);
+}
+
+#if HOST_SOLVERS
+/*
+ * Integer version of calcSun. Angles (latitude, longitude, zenith) are in
+ * TRIG_MAX_ANGLE units and the result is in minutes UTC. Times of day are
+ * kept as angles as well (TRIG_MAX_ANGLE is 24 hours) and ratios in
+ * TRIG_MAX_RATIO fixed point with the integer trig above, otherwise the steps
+ * are the same as calcSun.
+ */
+int calcSunFixed(int year, int month, int day, int32_t latitude, int32_t longitude, int sunset, int32_t zenith)
+{
+  int N1 = 275 * month / 9;
+  int N2 = (month + 9) / 12;
+  int N3 = 1 + (year - 4 * (year / 4) + 2) / 3;
+  int N = N1 - (N2 * N3) + day - 30;
+
+  return calcSunDayFixed(N, latitude, longitude, sunset, zenith);
+}
+#endif
+
+/* The terms of a day shared by all zeniths, for sunrise (6h) or sunset (18h) */
+typedef struct {
+  int32_t t;          // Day angle of the event time
+  int32_t RA;         // Right ascension
+  int64_t den;        // cosDec * cosLat
+  int64_t dec_lat;    // sinDec * sinLat
+} SunTerms;
+
+static void sun_terms(int N, int32_t latitude, int32_t longitude, int sunset, SunTerms *terms)
+{
+  // t = N + ((6 - lngHour) / 24), or 18 for sunset
+  int32_t t = N * TRIG_MAX_ANGLE + (sunset ? 3 : 1) * (TRIG_MAX_ANGLE / 4) - longitude;
+
+  // M = 0.9856 * t - 3.289 degrees
+  int32_t M = (int32_t)((int64_t)t * 179423 / 65536000) - 599;
+
+  // L = M + 1.916 * sin(M) + 0.020 * sin(2 * M) + 282.634 degrees
+  int32_t L = M + 3488 * my_isin(M) / (10 * TRIG_MAX_RATIO) + 364 * my_isin(2 * M) / (100 * TRIG_MAX_RATIO) + 51452;
+  L &= TRIG_MAX_ANGLE - 1;
+
+  int32_t sinL = my_isin(L);
+  int32_t cosL = my_icos(L);
+
+  // RA = atan(0.91764 * tan(L)), atan2 keeps it in the same quadrant as L
+  int32_t RA = my_iatan2(sinL * 15035 / 16384, cosL);
+
+  int32_t sinDec = sinL * 6518 / 16384;
+  int32_t cosDec = complement(sinDec);
+
+  terms->t = t;
+  terms->RA = RA;
+  terms->den = (int64_t)cosDec * my_icos(latitude);
+  terms->dec_lat = (int64_t)sinDec * my_isin(latitude);
+}
+
+/* The event of one zenith from the terms of its day, also setting whether the sun crosses it */
+static int sun_event(const SunTerms *terms, int32_t longitude, int sunset, int32_t zenith, SunEventsKind *kind)
+{
+  // cosH = (cos(zenith) - sinDec * sinLat) / (cosDec * cosLat)
+  int64_t num = (int64_t)my_icos(zenith) * TRIG_MAX_RATIO - terms->dec_lat;
+  if (num > terms->den) {
+    *kind = SUN_EVENTS_POLAR_NIGHT;
+    return 0;
+  }
+  if (num < -terms->den || terms->den == 0) {
+    *kind = SUN_EVENTS_POLAR_DAY;
+    return 0;
+  }
+  *kind = SUN_EVENTS_RISE_SET;
+  int64_t cosH = num * TRIG_MAX_RATIO / terms->den;
+
+  int32_t H = my_iacos((int32_t)cosH);
+  if (!sunset) H = TRIG_MAX_ANGLE - H;
+
+  // T = H + RA - (0.06571 * t) - 6.622 hours
+  int32_t T = H + terms->RA - (int32_t)((int64_t)terms->t * 273792 / 100000000) - 18083;
+
+  // adjust back to UTC and convert to minutes
+  int32_t UT = (T - longitude) & (TRIG_MAX_ANGLE - 1);
+
+  return ((UT * 1440 + TRIG_MAX_ANGLE / 2) / TRIG_MAX_ANGLE) % 1440;
+}
+
+/*
+ * Sunrise and sunset for several zeniths of a day N (1 based), and whether
+ * the sun crosses each zenith at all. The solar terms are worked out once at
+ * 6h for all the rises and once at 18h for all the sets, as calcSunDayFixed
+ * does for one, so each extra zenith only costs a division and an acos and
+ * the times are the same as calcSunDayFixed's. Against calcSun in double
+ * precision (|lat| <= 60, bench/sun_bench.c) the worst event is 0.7 min off
+ * at the official zenith, 0.8 civil and 4.3 nautical and astronomical, the
+ * terms at 6h and 18h being further from twilight events. A day is polar
+ * when either event is, they only disagree on the first or last day of a
+ * polar day or night.
+ */
+void calcSunEventsFixed(int N, int32_t latitude, int32_t longitude, const int32_t *zeniths, int count, SunEvents *events)
+{
+  SunTerms rise, set;
+  sun_terms(N, latitude, longitude, 0, &rise);
+  sun_terms(N, latitude, longitude, 1, &set);
+
+  for (int i = 0; i < count; i++) {
+    SunEvents *e = &events[i];
+    SunEventsKind set_kind;
+    e->rise = sun_event(&rise, longitude, 0, zeniths[i], &e->kind);
+    e->set = sun_event(&set, longitude, 1, zeniths[i], &set_kind);
+    if (e->kind == SUN_EVENTS_RISE_SET) e->kind = set_kind;
+    if (e->kind != SUN_EVENTS_RISE_SET) e->rise = e->set = 0;
+  }
+}
+
+/* calcSunEventsFixed for a single zenith */
+void calcSunDayEventsFixed(int N, int32_t latitude, int32_t longitude, int32_t zenith, SunEvents *events)
+{
+  calcSunEventsFixed(N, latitude, longitude, &zenith, 1, events);
+}
+
+#if HOST_SOLVERS
+/* calcSunFixed for a day of the year N (1 based), 0 when the sun does not cross the zenith */
+int calcSunDayFixed(int N, int32_t latitude, int32_t longitude, int sunset, int32_t zenith)
+{
+  SunTerms terms;
+  SunEventsKind kind;
+  sun_terms(N, latitude, longitude, sunset, &terms);
+  return sun_event(&terms, longitude, sunset, zenith, &kind);
+}
+
+int calcSunRiseFixed(int year, int month, int day, int32_t latitude, int32_t longitude, int32_t zenith)
+{
+  return calcSunFixed(year, month, day, latitude, longitude, 0, zenith);
+}
+
+int calcSunSetFixed(int year, int month, int day, int32_t latitude, int32_t longitude, int32_t zenith)
+{
+  return calcSunFixed(year, month, day, latitude, longitude, 1, zenith);
+}
+#endif
+
 int isspace(int c)
 {
   if(((char)c)==' ')
@@ -289,8 +794,12 @@ double strtod(const char *nptr, char **endptr)
         {
             if (isdigit((unsigned char)*nptr))
             {
-                xf = xf * 10 + (*nptr - '0');
-                xd = xd * 10;
+                // Digits past what a double holds change nothing, and would overflow xf and xd
+                if (xd < 1e18)
+                {
+                    xf = xf * 10 + (*nptr - '0');
+                    xd = xd * 10;
+                }
             }
             else
             {
@@ -308,13 +817,20 @@ double strtod(const char *nptr, char **endptr)
             es = -1;
             nptr++;
         }
+        else if (*nptr == '+')
+        {
+            nptr++;
+        }
         xd = 1;
         xf = 0;
         while (1)
         {
             if (isdigit((unsigned char)*nptr))
             {
+                // Anything past 1e400 is infinite already, don't loop for it
                 xf = xf * 10 + (*nptr - '0');
+                if (xf > 400)
+                    xf = 400;
                 nptr++;
             }
             else
@@ -324,13 +840,17 @@ double strtod(const char *nptr, char **endptr)
                     xd *= 10;
                     xf--;
                 }
-                if (es < 0.0)
+                // 0 stays 0 however large the exponent, 0 * inf would be NaN
+                if (x != 0.0)
                 {
-                    x = x / xd;
-                }
-                else
-                {
-                    x = x * xd;
+                    if (es < 0.0)
+                    {
+                        x = x / xd;
+                    }
+                    else
+                    {
+                        x = x * xd;
+                    }
                 }
                 break;
             }
@@ -349,12 +869,131 @@ double atof(const char *nptr)
 }
 
 
+/*
+ * Text formatting for the tick path without snprintf/strftime. Numbers go
+ * out two digits at a time from a table, and the day and month names of the
+ * active locale are taken from strftime once in format_init.
+ */
+static const char digit_pairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+#define NAME_SIZE 8
+static char day_names[7][NAME_SIZE];
+static char month_names[12][NAME_SIZE];
+
+/**
+ * Read the abbreviated day and month names of the current locale, call after
+ * setlocale
+ */
+void format_init()
+{
+  struct tm t;
+  memset(&t, 0, sizeof(t));
+  t.tm_mday = 1;
+  t.tm_year = 100;
+
+  for (int i = 0; i < 7; i++) {
+    t.tm_wday = i;
+    strftime(day_names[i], NAME_SIZE, "%a", &t);
+  }
+  for (int i = 0; i < 12; i++) {
+    t.tm_mon = i;
+    strftime(month_names[i], NAME_SIZE, "%b", &t);
+  }
+}
+
+/**
+ * Write two digits, 0 padded
+ *
+ * @param str    Where to write, at least 3 chars
+ * @param number The number, 0 to 99
+ */
+void format_two_digits(char *str, int number)
+{
+  str[0] = digit_pairs[2 * number];
+  str[1] = digit_pairs[2 * number + 1];
+  str[2] = '\0';
+}
+
+/**
+ * Append text, never writing past the end of the buffer
+ *
+ * @param str  Where to write
+ * @param end  The end of the buffer
+ * @param text The text to append
+ * @return The new end of the string
+ */
+char *format_append(char *str, char *end, const char *text)
+{
+  while (*text && str < end - 1) *str++ = *text++;
+  if (str < end) *str = '\0';
+  return str;
+}
+
+/**
+ * Append a number with thousands separators
+ *
+ * @param str    Where to write
+ * @param end    The end of the buffer
+ * @param number The number
+ * @return The new end of the string
+ */
+char *format_append_number(char *str, char *end, int number)
+{
+  char digits[16];
+  char *p = digits + sizeof(digits);
+  unsigned int n = number < 0 ? -(unsigned int)number : (unsigned int)number;
+  int count = 0;
+
+  *--p = '\0';
+  do {
+    // Two digits at a time, with a separator before every third
+    unsigned int pair = n % 100;
+    int width = n >= 10 ? 2 : 1;
+    for (int i = 0; i < width; i++) {
+      if (count && count % 3 == 0) *--p = ',';
+      *--p = digit_pairs[2 * pair + 1 - i];
+      count++;
+    }
+    n /= 100;
+  } while (n);
+  if (number < 0) *--p = '-';
+
+  return format_append(str, end, p);
+}
+
 void format_number(char *str, int size, int number)
 {
-  if (number > 1000)
-    snprintf(str, size, "%d,%03d", number / 1000, number % 1000);
-  else
-    snprintf(str, size, "%d", number);
+  format_append_number(str, str + size, number);
+}
+
+/**
+ * Format a date like strftime "%d %b"
+ */
+void format_date(char *str, int size, const struct tm *t)
+{
+  char day[3];
+  format_two_digits(day, t->tm_mday);
+  char *p = format_append(str, str + size, day);
+  p = format_append(p, str + size, " ");
+  format_append(p, str + size, month_names[t->tm_mon]);
+}
+
+/**
+ * Format a day like strftime "%a"
+ */
+void format_day(char *str, int size, const struct tm *t)
+{
+  format_append(str, str + size, day_names[t->tm_wday]);
 }
 
 double round(double number)
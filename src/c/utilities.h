@@ -1,4 +1,31 @@
+#ifndef M_PI
 #define M_PI 3.141592653589793
+#endif
+
+// The float helpers, calcSun and the integer solvers the watch does not call
+// (all but calcSunEventsFixed and calcSunDayEventsFixed) are only built for
+// the host benchmarks in bench/, which set this. They would take flash and
+// RAM on aplite for nothing.
+#ifndef HOST_SOLVERS
+#define HOST_SOLVERS 0
+#endif
+
+#if HOST_SOLVERS
+// Precision tiers of the float helpers, errors and costs are listed in utilities.c
+#define MATH_FAST     0
+#define MATH_BALANCED 1
+#define MATH_ACCURATE 2
+
+// Tier of the my_* functions, can be overridden from the build flags
+#ifndef MATH_PRECISION
+#define MATH_PRECISION MATH_BALANCED
+#endif
+
+// Tier used inside calcSun, the cheapest one keeping sun times within a minute
+#ifndef SUN_PRECISION
+#define SUN_PRECISION MATH_BALANCED
+#endif
+
 float my_sqrt(const float x);
 float my_floor(float x); 
 float my_fabs(float x);
@@ -9,19 +36,68 @@ float my_cos(float x);
 float my_acos (float x);
 float my_asin (float x);
 float my_tan(float x);
+#endif
 
 #define ZENITH_OFFICIAL 90.83
 #define ZENITH_CIVIL    96.0
 #define ZENITH_NAUTICAL 102.0
 #define ZENITH_ASTRONOMICAL 108.0
 
+#if HOST_SOLVERS
 float calcSun(int year, int month, int day, float latitude, float longitude, int sunset, float zenith);
 float calcSunRise(int year, int month, int day, float latitude, float longitude, float zenith);
 float calcSunSet(int year, int month, int day, float latitude, float longitude, float zenith);
+void calcSunBatch(int count, const int *days, const float *latitudes, const float *longitudes, float zenith, float *rises, float *sets);
+#endif
+
+#define ZENITH_OFFICIAL_ANGLE ((int32_t)DEG_TO_TRIGANGLE(ZENITH_OFFICIAL))
+#define ZENITH_CIVIL_ANGLE    ((int32_t)DEG_TO_TRIGANGLE(ZENITH_CIVIL))
+#define ZENITH_NAUTICAL_ANGLE ((int32_t)DEG_TO_TRIGANGLE(ZENITH_NAUTICAL))
+#define ZENITH_ASTRONOMICAL_ANGLE ((int32_t)DEG_TO_TRIGANGLE(ZENITH_ASTRONOMICAL))
+
+// Micro degrees (as sent by the phone) to TRIG_MAX_ANGLE units
+#define E6_TO_TRIGANGLE(e6) ((int32_t)((int64_t)(e6) * TRIG_MAX_ANGLE / 360000000))
+
+uint32_t my_isqrt(uint32_t x);
+int32_t my_isin(int32_t angle);
+int32_t my_icos(int32_t angle);
+int32_t my_itan(int32_t angle);
+int32_t my_iatan2(int32_t y, int32_t x);
+int32_t my_iasin(int32_t x);
+int32_t my_iacos(int32_t x);
+
+// Whether the sun crosses a zenith on a day, or stays above (polar day) or below it (polar night)
+typedef enum {
+  SUN_EVENTS_RISE_SET,
+  SUN_EVENTS_POLAR_DAY,
+  SUN_EVENTS_POLAR_NIGHT
+} SunEventsKind;
+
+typedef struct {
+  SunEventsKind kind;
+  int16_t rise;   // Minutes UTC, only set for SUN_EVENTS_RISE_SET
+  int16_t set;
+} SunEvents;
+
+void calcSunEventsFixed(int N, int32_t latitude, int32_t longitude, const int32_t *zeniths, int count, SunEvents *events);
+void calcSunDayEventsFixed(int N, int32_t latitude, int32_t longitude, int32_t zenith, SunEvents *events);
+
+#if HOST_SOLVERS
+int calcSunFixed(int year, int month, int day, int32_t latitude, int32_t longitude, int sunset, int32_t zenith);
+int calcSunDayFixed(int N, int32_t latitude, int32_t longitude, int sunset, int32_t zenith);
+int calcSunRiseFixed(int year, int month, int day, int32_t latitude, int32_t longitude, int32_t zenith);
+int calcSunSetFixed(int year, int month, int day, int32_t latitude, int32_t longitude, int32_t zenith);
+#endif
 
 
 double atof(const char *nptr);
 
+void format_init();
+void format_two_digits(char *str, int number);
+char *format_append(char *str, char *end, const char *text);
+char *format_append_number(char *str, char *end, int number);
 void format_number(char *str, int size, int number);
+void format_date(char *str, int size, const struct tm *t);
+void format_day(char *str, int size, const struct tm *t);
 
 double round(double number);
\ No newline at end of file
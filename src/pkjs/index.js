@@ -1,6 +1,64 @@
 var battery_percentage = -1;
 var battery_charging = -1;
 
+// Messages to the watch are merged into one pending dictionary and sent at
+// most every SEND_INTERVAL ms, a newer value for a key replaces an unsent one.
+// Failed sends are retried with an exponential backoff.
+var SEND_INTERVAL = 2000;
+var RETRY_MIN = 1000;
+var RETRY_MAX = 60000;
+
+var pending = {};
+var inFlight = null;
+var sendTimer = null;
+var lastSend = 0;
+var retryDelay = RETRY_MIN;
+
+function queueMessage(dict) {
+  for (var key in dict) {
+    if (dict.hasOwnProperty(key)) {
+      pending[key] = dict[key];
+    }
+  }
+  scheduleSend(0);
+}
+
+function scheduleSend(delay) {
+  if (sendTimer !== null || inFlight !== null) {
+    return;
+  }
+  var wait = Math.max(delay, lastSend + SEND_INTERVAL - Date.now(), 0);
+  sendTimer = setTimeout(flushMessages, wait);
+}
+
+function flushMessages() {
+  sendTimer = null;
+  if (Object.keys(pending).length === 0) {
+    return;
+  }
+
+  inFlight = pending;
+  pending = {};
+  lastSend = Date.now();
+
+  Pebble.sendAppMessage(inFlight, function () {
+    inFlight = null;
+    retryDelay = RETRY_MIN;
+    scheduleSend(0);
+  }, function (e) {
+    console.warn('send failed, retrying in ' + retryDelay + 'ms');
+    // Keep the values that have not been replaced while this was in flight
+    for (var key in inFlight) {
+      if (inFlight.hasOwnProperty(key) && !pending.hasOwnProperty(key)) {
+        pending[key] = inFlight[key];
+      }
+    }
+    inFlight = null;
+    scheduleSend(retryDelay);
+    retryDelay = Math.min(retryDelay * 2, RETRY_MAX);
+  });
+}
+
 navigator.getBattery().then(function(battery) {
   battery.addEventListener('chargingchange', function(){
     updateChargeInfo();
@@ -8,7 +66,7 @@ navigator.getBattery().then(function(battery) {
   function updateChargeInfo(){
     battery_charging = battery.charging ? 1 : 0;
     console.log("Battery charging " + battery_charging);
-    Pebble.sendAppMessage({'PhoneBatteryCharging' : battery_charging});
+    queueMessage({'PhoneBatteryCharging' : battery_charging});
   }
 
   battery.addEventListener('levelchange', function(){
@@ -17,7 +75,7 @@ navigator.getBattery().then(function(battery) {
   function updateLevelInfo(){
     battery_percentage = Math.floor(battery.level * 100);
     console.log("Battery percentage " + battery_percentage);
-    Pebble.sendAppMessage({'PhoneBattery' : battery_percentage});
+    queueMessage({'PhoneBattery' : battery_percentage});
     if (battery_percentage == 100) {
       Pebble.showSimpleNotificationOnPebble("Phone Battery", "Phone battery fully charged");
     } else if (battery_charging === 0) {
@@ -34,22 +92,94 @@ navigator.getBattery().then(function(battery) {
 
 });
 
-function locationSuccess(pos) {
-  var coordinates = pos.coords;
-  localStorage.setItem('Longitude', coordinates.longitude);
-  localStorage.setItem('Latitude', coordinates.latitude);
-  Pebble.sendAppMessage({
-    'Longitude': '' + coordinates.longitude,
-    'Latitude' : '' + coordinates.latitude
+// Coordinates go to the watch as int32 micro degrees, so it does not have to parse them
+function toMicroDegrees(degrees) {
+  return Math.round(degrees * 1000000);
+}
+
+function sendLocation(lat, lon) {
+  queueMessage({
+    'LongitudeE6': toMicroDegrees(lon),
+    'LatitudeE6' : toMicroDegrees(lat)
   });
 }
 
+// A fix younger than this is used without asking for a new one
+var LOCATION_MAX_AGE = 6 * 3600000;
+// Moves that shift sunrise/sunset by less than this (minutes) are not sent
+var MIN_SUN_SHIFT = 1;
+
+// The location the watch has been sent since it connected
+var sentLocation = null;
+
+function loadLocation() {
+  var stored = localStorage.getItem('Location');
+  if (stored !== null) {
+    try {
+      return JSON.parse(stored);
+    } catch (e) {
+      console.warn('bad stored location: ' + stored);
+    }
+  }
+
+  // Location stored by older versions, without a time it is always stale
+  var lat = localStorage.getItem('Latitude');
+  var lon = localStorage.getItem('Longitude');
+  if (lat !== null && lon !== null) {
+    return {'lat': parseFloat(lat), 'lon': parseFloat(lon), 'accuracy': -1, 'time': 0};
+  }
+  return null;
+}
+
+// Sun declinations sampled over the year, the solstices move the most
+var SUN_DECLINATIONS = [-23.44, -11.72, 0, 11.72, 23.44];
+
+// Half of the daylight in degrees of hour angle at the official zenith,
+// 0 or 180 on polar nights and days
+function sunHourAngle(lat, dec) {
+  var rad = Math.PI / 180;
+  var cosH = (Math.cos(90.833 * rad) - Math.sin(dec * rad) * Math.sin(lat * rad)) /
+             (Math.cos(dec * rad) * Math.cos(lat * rad));
+  return Math.acos(Math.max(-1, Math.min(1, cosH))) / rad;
+}
+
+// How far sunrise/sunset move between two places over the year: 4 minutes
+// per degree of longitude, plus the largest change of the hour angle with
+// the latitude, which grows quickly towards the polar circles
+function sunShiftMinutes(a, b) {
+  var latShift = 0;
+  SUN_DECLINATIONS.forEach(function (dec) {
+    latShift = Math.max(latShift, Math.abs(sunHourAngle(a.lat, dec) - sunHourAngle(b.lat, dec)));
+  });
+  return 4 * Math.abs(a.lon - b.lon) + 4 * latShift;
+}
+
+function forwardLocation(fix, force) {
+  if (!force && sentLocation !== null && sunShiftMinutes(fix, sentLocation) < MIN_SUN_SHIFT) {
+    console.log('location moved too little to send');
+    return;
+  }
+  sentLocation = fix;
+  sendLocation(fix.lat, fix.lon);
+}
+
+function locationSuccess(pos) {
+  var fix = {
+    'lat': pos.coords.latitude,
+    'lon': pos.coords.longitude,
+    'accuracy': pos.coords.accuracy,
+    'time': Date.now()
+  };
+  localStorage.setItem('Location', JSON.stringify(fix));
+  forwardLocation(fix, false);
+}
+
 function locationError(err) {
   console.warn('location error (' + err.code + '): ' + err.message);
-  Pebble.sendAppMessage({
-    'Longitude': '0.0',
-    'Latitude' : '0.0'
-  });
+  // An old fix is still better than none
+  if (loadLocation() === null) {
+    sendLocation(0, 0);
+  }
 }
 
 var locationOptions = {
@@ -58,25 +188,30 @@ var locationOptions = {
   'maximumAge': 3600000
 };
 
+function requestLocation() {
+  var fix = loadLocation();
+  if (fix !== null && Date.now() - fix.time < LOCATION_MAX_AGE) {
+    forwardLocation(fix, false);
+    return;
+  }
+  window.navigator.geolocation.getCurrentPosition(locationSuccess, locationError, locationOptions);
+}
+
 Pebble.addEventListener('ready', function (e) {
   console.log('connect!' + e.ready);
   setTimeout(function(){
-    var lat = localStorage.getItem('Latitude');
-    var lon = localStorage.getItem('Longitude');
-    if (lat !== null && lon !== null) {
-      Pebble.sendAppMessage({
-        'Longitude': '' + lon,
-        'Latitude' : '' + lat
-      });
-    } else {
-      window.navigator.geolocation.getCurrentPosition(locationSuccess, locationError, locationOptions);
+    // The watch has just started, give it what we have right away
+    var fix = loadLocation();
+    if (fix !== null) {
+      forwardLocation(fix, true);
     }
+    requestLocation();
   }, 1000);
   console.log(e.type);
 });
 
 Pebble.addEventListener('appmessage', function (e) {
-  window.navigator.geolocation.getCurrentPosition(locationSuccess, locationError, locationOptions);
+  requestLocation();
   console.log(e.type);
 });
 